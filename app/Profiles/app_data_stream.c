@@ -25,6 +25,7 @@ $Release Date: PACKAGE RELEASE DATE $
 #include <common/MenuModule/menu_module.h>
 #include <app_main.h>
 #include <trans_uartApi.h>
+#include <common/FreeRTOSCli/cli_api.h>
 
 //*****************************************************************************
 //! Defines
@@ -68,7 +69,9 @@ static DSP_cb_t ds_profileCB =
  */
 static void DS_onCccUpdateCB( uint16 connHandle, uint16 pValue )
 {
-    // MenuModule closed, no function in here
+  cli_urcPost(CLI_URC_CCC, "+CCC:%d,%d", connHandle, pValue);
+
+  // MenuModule closed, no function in here
   if ( pValue == DS_CCC_UPDATE_NOTIFICATION_ENABLED)
   {
     MenuModule_printf(APP_MENU_PROFILE_STATUS_LINE, 0,
@@ -25,6 +25,8 @@ $Release Date: PACKAGE RELEASE DATE $
 #include "ti_ble_config.h"
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
 #include <common/MenuModule/menu_module.h>
+#include <common/FreeRTOSCli/cli_api.h>
+#include <common/Drivers/NV/nv_log.h>
 #include <app_main.h>
 
 //*****************************************************************************
@@ -35,6 +37,9 @@ void Connection_HciGAPEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData);
 
 static uint8_t Connection_addConnInfo(uint16_t connHandle, uint8_t *pAddr);
 static uint8_t Connection_removeConnInfo(uint16_t connHandle);
+static void Connection_updateConnNum(char *pData);
+static void Connection_paramUpdateRsp(char *pData);
+static void Connection_paramUpdated(char *pData);
 
 //*****************************************************************************
 //! Globals
@@ -73,6 +78,9 @@ static App_connInfo connectionConnList[MAX_NUM_BLE_CONNS];
  * @brief   The purpose of this function is to handle connection related
  *          events that rise from the GAP and were registered in
  *          @ref BLEAppUtil_registerEventHandler
+ *          This may run in the stack context (BLEAPPUTIL_DIRECT_STACK_DISPATCH),
+ *          the stack calls are made from the BLEAppUtil task with
+ *          @ref BLEAppUtil_invokeFunction.
  *
  * @param   event - message event.
  * @param   pMsgData - pointer to message data.
@@ -90,18 +98,18 @@ void Connection_ConnEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
             // Add the connection to the connected device list
             Connection_addConnInfo(gapEstMsg->connectionHandle, gapEstMsg->devAddr);
 
-            Monitor_updateState(APP_MONITOR_STATE_CONN_NUM, linkDB_NumActive());
-
             /*! Print the peer address and connection handle number */
             MenuModule_printf(APP_MENU_CONN_EVENT, 0, "Conn status: Established - "
                               "Connected to " MENU_MODULE_COLOR_YELLOW "%s " MENU_MODULE_COLOR_RESET
                               "connectionHandle = " MENU_MODULE_COLOR_YELLOW "%d" MENU_MODULE_COLOR_RESET,
                               BLEAppUtil_convertBdAddr2Str(gapEstMsg->devAddr), gapEstMsg->connectionHandle);
 
-            /*! Print the number of current connections */
-            MenuModule_printf(APP_MENU_NUM_CONNS, 0, "Connections number: "
-                              MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET,
-                              linkDB_NumActive());
+            cli_urcPost(CLI_URC_CONN, "+CONN:%d,%02X%02X%02X%02X%02X%02X",
+                        gapEstMsg->connectionHandle,
+                        gapEstMsg->devAddr[5], gapEstMsg->devAddr[4], gapEstMsg->devAddr[3],
+                        gapEstMsg->devAddr[2], gapEstMsg->devAddr[1], gapEstMsg->devAddr[0]);
+
+            BLEAppUtil_invokeFunctionNoData(Connection_updateConnNum);
 
             break;
         }
@@ -109,39 +117,43 @@ void Connection_ConnEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
         case BLEAPPUTIL_LINK_TERMINATED_EVENT:
         {
             gapTerminateLinkEvent_t *gapTermMsg = (gapTerminateLinkEvent_t *)pMsgData;
+            uint8 logData[3];
 
             // Remove the connection from the conneted device list
             Connection_removeConnInfo(gapTermMsg->connectionHandle);
 
-            Monitor_updateState(APP_MONITOR_STATE_CONN_NUM, linkDB_NumActive());
-
             /*! Print the peer address and connection handle number */
             MenuModule_printf(APP_MENU_CONN_EVENT, 0, "Conn status: Terminated - "
                               "connectionHandle = " MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET
                               "reason = " MENU_MODULE_COLOR_YELLOW "%d" MENU_MODULE_COLOR_RESET,
                               gapTermMsg->connectionHandle, gapTermMsg->reason);
 
-            /*! Print the number of current connections */
-            MenuModule_printf(APP_MENU_NUM_CONNS, 0, "Connections number: "
-                              MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET,
-                              linkDB_NumActive());
+            cli_urcPost(CLI_URC_DISC, "+DISC:%d,%d",
+                        gapTermMsg->connectionHandle, gapTermMsg->reason);
+
+            // Kept across resets, see AT+LOGDUMP
+            logData[0] = LO_UINT16(gapTermMsg->connectionHandle);
+            logData[1] = HI_UINT16(gapTermMsg->connectionHandle);
+            logData[2] = gapTermMsg->reason;
+            NvTask_log(NV_LOG_DISCONN, logData, sizeof(logData));
+
+            BLEAppUtil_invokeFunctionNoData(Connection_updateConnNum);
 
             break;
         }
 
         case BLEAPPUTIL_LINK_PARAM_UPDATE_REQ_EVENT:
         {
-            gapUpdateLinkParamReqEvent_t *pReq = (gapUpdateLinkParamReqEvent_t *)pMsgData;
+            // The reply is a stack call, the request is copied for it
+            gapUpdateLinkParamReqEvent_t *pReq = ICall_malloc(sizeof(gapUpdateLinkParamReqEvent_t));
 
-            // Only accept connection intervals with slave latency of 0
-            // This is just an example of how the application can send a response
-            if(pReq->req.connLatency == 0)
-            {
-                BLEAppUtil_paramUpdateRsp(pReq,TRUE);
-            }
-            else
+            if (pReq != NULL)
             {
-                BLEAppUtil_paramUpdateRsp(pReq,FALSE);
+                memcpy(pReq, pMsgData, sizeof(gapUpdateLinkParamReqEvent_t));
+                if (BLEAppUtil_invokeFunction(Connection_paramUpdateRsp, (char *)pReq) != SUCCESS)
+                {
+                    ICall_free(pReq);
+                }
             }
 
             break;
@@ -149,26 +161,16 @@ void Connection_ConnEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
 
         case BLEAPPUTIL_LINK_PARAM_UPDATE_EVENT:
         {
-            gapLinkUpdateEvent_t *pPkt = (gapLinkUpdateEvent_t *)pMsgData;
+            // The link is looked up in the stack, the event is copied for it
+            gapLinkUpdateEvent_t *pPkt = ICall_malloc(sizeof(gapLinkUpdateEvent_t));
 
-            // Get the address from the connection handle
-            linkDBInfo_t linkInfo;
-            if (linkDB_GetInfo(pPkt->connectionHandle, &linkInfo) ==  SUCCESS)
+            if (pPkt != NULL)
             {
-              // The status HCI_ERROR_CODE_PARAM_OUT_OF_MANDATORY_RANGE indicates that connection params did not change but the req and rsp still transpire
-              if((pPkt->status == SUCCESS) || (pPkt->status == HCI_ERROR_CODE_PARAM_OUT_OF_MANDATORY_RANGE))
-              {
-                  MenuModule_printf(APP_MENU_CONN_EVENT, 0, "Conn status: Params update - "
-                                    "connectionHandle = " MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET,
-                                    pPkt->connectionHandle);
-              }
-              else
-              {
-                  MenuModule_printf(APP_MENU_CONN_EVENT, 0, "Conn status: Params update failed - "
-                                    MENU_MODULE_COLOR_YELLOW "0x%x " MENU_MODULE_COLOR_RESET
-                                    "connectionHandle = " MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET,
-                                    pPkt->opcode, pPkt->connectionHandle);
-              }
+                memcpy(pPkt, pMsgData, sizeof(gapLinkUpdateEvent_t));
+                if (BLEAppUtil_invokeFunction(Connection_paramUpdated, (char *)pPkt) != SUCCESS)
+                {
+                    ICall_free(pPkt);
+                }
             }
 
             break;
@@ -181,6 +183,88 @@ void Connection_ConnEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
     }
 }
 
+/*********************************************************************
+ * @fn      Connection_updateConnNum
+ *
+ * @brief   Report the number of active connections, called from the
+ *          BLEAppUtil task after a link is established or terminated
+ *
+ * @param   pData - not used
+ *
+ * @return  none
+ */
+static void Connection_updateConnNum(char *pData)
+{
+    Monitor_updateState(APP_MONITOR_STATE_CONN_NUM, linkDB_NumActive());
+
+    /*! Print the number of current connections */
+    MenuModule_printf(APP_MENU_NUM_CONNS, 0, "Connections number: "
+                      MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET,
+                      linkDB_NumActive());
+}
+
+/*********************************************************************
+ * @fn      Connection_paramUpdateRsp
+ *
+ * @brief   Answer a connection parameter update request, called from
+ *          the BLEAppUtil task
+ *
+ * @param   pData - copy of the gapUpdateLinkParamReqEvent_t, freed by
+ *                  BLEAppUtil
+ *
+ * @return  none
+ */
+static void Connection_paramUpdateRsp(char *pData)
+{
+    gapUpdateLinkParamReqEvent_t *pReq = (gapUpdateLinkParamReqEvent_t *)pData;
+
+    // Only accept connection intervals with slave latency of 0
+    // This is just an example of how the application can send a response
+    if(pReq->req.connLatency == 0)
+    {
+        BLEAppUtil_paramUpdateRsp(pReq,TRUE);
+    }
+    else
+    {
+        BLEAppUtil_paramUpdateRsp(pReq,FALSE);
+    }
+}
+
+/*********************************************************************
+ * @fn      Connection_paramUpdated
+ *
+ * @brief   Report a connection parameter update, called from the
+ *          BLEAppUtil task
+ *
+ * @param   pData - copy of the gapLinkUpdateEvent_t, freed by BLEAppUtil
+ *
+ * @return  none
+ */
+static void Connection_paramUpdated(char *pData)
+{
+    gapLinkUpdateEvent_t *pPkt = (gapLinkUpdateEvent_t *)pData;
+
+    // Get the address from the connection handle
+    linkDBInfo_t linkInfo;
+    if (linkDB_GetInfo(pPkt->connectionHandle, &linkInfo) ==  SUCCESS)
+    {
+      // The status HCI_ERROR_CODE_PARAM_OUT_OF_MANDATORY_RANGE indicates that connection params did not change but the req and rsp still transpire
+      if((pPkt->status == SUCCESS) || (pPkt->status == HCI_ERROR_CODE_PARAM_OUT_OF_MANDATORY_RANGE))
+      {
+          MenuModule_printf(APP_MENU_CONN_EVENT, 0, "Conn status: Params update - "
+                            "connectionHandle = " MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET,
+                            pPkt->connectionHandle);
+      }
+      else
+      {
+          MenuModule_printf(APP_MENU_CONN_EVENT, 0, "Conn status: Params update failed - "
+                            MENU_MODULE_COLOR_YELLOW "0x%x " MENU_MODULE_COLOR_RESET
+                            "connectionHandle = " MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET,
+                            pPkt->opcode, pPkt->connectionHandle);
+      }
+    }
+}
+
 /*********************************************************************
  * @fn      Connection_HciGAPEventHandler
  *
@@ -241,6 +325,8 @@ void Connection_HciGAPEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
               }
               else
               {
+                  cli_urcPost(CLI_URC_PHY, "+PHY:%d,%d,%d",
+                              pPUC->connHandle, pPUC->txPhy, pPUC->rxPhy);
 #if !defined(Display_DISABLE_ALL)
                   char * currPhy =
                           (pPUC->rxPhy == PHY_UPDATE_COMPLETE_EVENT_1M) ? "1 Mbps" :
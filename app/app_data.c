@@ -20,6 +20,7 @@ $Release Date: PACKAGE RELEASE DATE $
 #include <string.h>
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
 #include <common/MenuModule/menu_module.h>
+#include <common/FreeRTOSCli/cli_api.h>
 #include <app_main.h>
 
 //*****************************************************************************
@@ -73,6 +74,8 @@ static void GATT_EventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
       {
           MenuModule_printf(APP_MENU_PROFILE_STATUS_LINE, 0, "GATT status: ATT MTU update to %d",
                             (( attMtuUpdatedEvt_t * )pMsgData)->MTU);
+          cli_urcPost(CLI_URC_MTU, "+MTU:%d,%d",
+                      gattMsg->connHandle, gattMsg->msg.mtuEvt.MTU);
       }
       break;
 
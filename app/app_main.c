@@ -21,6 +21,9 @@ $Release Date: PACKAGE RELEASE DATE $
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
 #include <common/MenuModule/menu_module.h>
 #include <app_main.h>
+#include <app_nv_items.h>
+#include <common/FreeRTOSCli/cli_api.h>
+#include <common/Drivers/NV/nv_log.h>
 
 
 //*****************************************************************************
@@ -52,6 +55,12 @@ BLEAppUtil_PeriCentParams_t appMainPeriCentParams =
 #endif
 };
 
+//*****************************************************************************
+//! Local Functions
+//*****************************************************************************
+static void App_nvBoot(void);
+static void App_settingsLoaded(char *pData);
+
 //*****************************************************************************
 //! Functions
 //*****************************************************************************
@@ -175,6 +184,61 @@ void App_StackInitDoneHandler(gapDeviceInitDoneEvent_t *deviceInitDoneData)
     // TODO: Call Error Handler
     }
 #endif
+
+    // NV work off the BLE path: compaction ahead of time, the NV cache the
+    // settings are read through, and App_nvBoot
+    status = NvTask_start(App_nvBoot);
+    if ( status != SUCCESS )
+    {
+    // TODO: Call Error Handler
+    }
+}
+
+/*********************************************************************
+ * @fn      App_nvBoot
+ *
+ * @brief   NV work at start up, run first in the NV task so that a log page
+ *          erase or the first boot defaults do not hold up the BLEAppUtil
+ *          task. The settings are then applied in the BLEAppUtil context.
+ *
+ * @return  none
+ */
+static void App_nvBoot(void)
+{
+    // Event log for AT+LOGDUMP, marks this boot
+    nvLog_init();
+
+    // First boot or new item versions: write the defaults of APP_NV_ITEMS
+    NvItems_init();
+
+    // Settings stored by AT&W
+    Settings_load();
+
+    BLEAppUtil_invokeFunctionNoData(App_settingsLoaded);
+}
+
+/*********************************************************************
+ * @fn      App_settingsLoaded
+ *
+ * @brief   Apply the settings read by App_nvBoot, may start advertising.
+ *          Called in the BLEAppUtil context.
+ *
+ * @param   pData - not used
+ *
+ * @return  none
+ */
+static void App_settingsLoaded(char *pData)
+{
+    bStatus_t status;
+
+    status = Settings_apply(TRUE);
+    if ( status != SUCCESS )
+    {
+    // TODO: Call Error Handler
+    }
+
+    // Run the "boot" AT script if one is stored
+    cli_scriptRequest("boot", 4);
 }
 
 /*********************************************************************
@@ -19,6 +19,7 @@ $Release Date: PACKAGE RELEASE DATE $
 //! Includes
 //*****************************************************************************
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
+#include <common/Drivers/NV/nvintf.h>
 
 //*****************************************************************************
 //! Defines
@@ -27,6 +28,20 @@ $Release Date: PACKAGE RELEASE DATE $
 #define MONITOR_ADV_ON      (1)
 #define MONITOR_BLE_NOINIT  (0)
 #define MONITOR_BLE_INIT    (1)
+
+// Scan stream filters, see App_scanFilter
+#define APP_SCAN_FILTER_RSSI        (0x01)
+#define APP_SCAN_FILTER_NAME        (0x02)
+#define APP_SCAN_FILTER_UUID        (0x04)
+#define APP_SCAN_FILTER_MFG         (0x08)
+#define APP_SCAN_FILTER_NAME_LEN    (16)
+
+// Bump when App_settings changes, older stored settings are then ignored
+#define APP_SETTINGS_VERSION        (2)
+
+// TX power level that was never set, the stack default applies
+#define APP_TXPOWER_NOT_SET         (127)
+#define APP_TXPOWER_MAX_LEVELS      (32)
 //*****************************************************************************
 //! Typedefs
 //*****************************************************************************
@@ -55,6 +70,30 @@ PACKED_ALIGNED_TYPEDEF_STRUCT
   BLEAppUtil_BDaddr  address;
 }App_scanResults;
 
+// Filters applied to the scan stream, see Observer_scanStreamStart
+typedef struct
+{
+  uint8  flags;                                 // APP_SCAN_FILTER_xxx of the active filters
+  int8   minRssi;                               // Lowest RSSI accepted
+  uint8  nameLen;                               // Length of namePrefix
+  char   namePrefix[APP_SCAN_FILTER_NAME_LEN];  // Local name prefix
+  uint16 uuid;                                  // 16-bit service UUID
+  uint16 mfgId;                                 // Manufacturer specific data company ID
+} App_scanFilter;
+
+// Settings kept in NV by AT&W, see app_settings.c
+typedef struct
+{
+  uint8  version;                               // APP_SETTINGS_VERSION
+  uint8  echo;                                  // CLI_UART_ECHO / CLI_UART_NO_ECHO
+  uint8  urcMask;                               // CLI_URC_xxx
+  uint8  advOnBoot;                             // Advertising was on at AT&W
+  uint32 advIntMin;                             // Adv interval (0.625 ms), 0 keeps the default
+  uint32 advIntMax;
+  int8   txPower;                               // Default TX power (dBm), APP_TXPOWER_NOT_SET
+  int8   advTxPower;                            // TX power of the adv set (dBm), APP_TXPOWER_NOT_SET
+} App_settings;
+
 // Connected device information
 PACKED_ALIGNED_TYPEDEF_STRUCT
 {
@@ -98,6 +137,7 @@ bStatus_t Peripheral_advStart(void);
 bStatus_t Peripheral_advRestart(void);
 bStatus_t Peripheral_advStop(void);
 bStatus_t Peripheral_setAdvParam(uint8 param_id, void* value);
+uint8 Peripheral_getAdvHandle(void);
 
 /*********************************************************************
  * @fn      Broadcaster_start
@@ -135,6 +175,30 @@ bStatus_t Central_start(void);
  */
 bStatus_t Observer_start(void);
 
+/*********************************************************************
+ * @fn      Observer_scanStreamStart
+ *
+ * @brief   Scan for duration seconds and print the matching adv reports
+ *          to the CLI UART. A running scan is restarted. The scan is
+ *          started from the BLEAppUtil task, a failed start is reported
+ *          with +SCANDONE:0,0.
+ *
+ * @param   duration - scan duration in seconds
+ * @param   pFilter  - filters to apply to the adv reports
+ *
+ * @return  SUCCESS, errorInfo
+ */
+bStatus_t Observer_scanStreamStart(uint16 duration, const App_scanFilter *pFilter);
+
+/*********************************************************************
+ * @fn      Observer_scanStreamStop
+ *
+ * @brief   Stop the scan started by Observer_scanStreamStart
+ *
+ * @return  SUCCESS, errorInfo
+ */
+bStatus_t Observer_scanStreamStop(void);
+
 /*********************************************************************
  * @fn      Connection_start
  *
@@ -288,6 +352,39 @@ uint16_t Connection_getConnhandle(uint8_t index);
  */
 uint16_t Connection_getConnIndex(uint16_t connHandle);
 
+/*********************************************************************
+ * @module	Settings
+ */
+// Change one field of the active profile, e.g. Settings_set(echo, CLI_UART_ECHO)
+#define Settings_set(field, value)  do { Settings_lock(); Settings_get()->field = (value); Settings_unlock(); } while (0)
+
+void Settings_lock(void);
+void Settings_unlock(void);
+App_settings *Settings_get(void);
+bStatus_t Settings_load(void);
+bStatus_t Settings_save(void);
+bStatus_t Settings_factoryReset(void);
+bStatus_t Settings_apply(uint8 startAdv);
+
+/*********************************************************************
+ * @module	TxPower
+ */
+uint8 TxPower_getLevels(int8 *pLevels, uint8 maxLevels);
+uint8 TxPower_isSupported(int8 dBm);
+bStatus_t TxPower_setDefault(int8 dBm);
+int8 TxPower_getDefault(void);
+bStatus_t TxPower_setAdv(uint8 advHandle, int8 dBm);
+
+/*********************************************************************
+ * @module	NvTask
+ */
+bStatus_t NvTask_start(void (*pBootFxn)(void));
+void NvTask_kick(void);
+NVINTF_nvFuncts_t *NvTask_getNvApi(void);
+uint32_t NvTask_getCompactions(void);
+void NvTask_getStack(uint32_t *pSize, uint32_t *pMinFree);
+bStatus_t NvTask_log(uint8 type, const void *pData, uint16 len);
+
 /*********************************************************************
  * @module	Monitor
  */
@@ -0,0 +1,266 @@
+/******************************************************************************
+
+@file  app_nv.c
+
+@brief Low priority NV maintenance task.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * NVOCMP compacts the active page inside the write that finds it full, so a
+ * bond write during pairing may wait for a page copy and an erase. This task
+ * compacts ahead of time instead, when less than APP_NV_LOW_WATER bytes are
+ * left (expectComp), checked every APP_NV_CHECK_PERIOD_MS and on
+ * NvTask_kick(). A foreground write then waits at most for the one
+ * compaction holding the NV lock, and writes up to APP_NV_LOW_WATER bytes
+ * do not compact at all.
+ * A page that stays low after a compaction is only compacted again once more
+ * has been written to it, compacting again would just wear the flash.
+ *
+ * The task also ticks the NV write-back cache (nv_cache.c). App items go
+ * through NvTask_getNvApi() and are added with nvCache_addItem(), held
+ * writes then reach flash within NV_CACHE_FLUSH_TICKS periods. There is no
+ * brown-out flush (NVOCMP's voltage check reads the CC26xx AON BATMON), so
+ * an item which must survive a power cut is flushed by its writer, as the
+ * AT&W settings are.
+ *
+ * Code on the BLE path (BLEAppUtil task, stack callbacks) queues its event
+ * log records (nv_log.c) with NvTask_log() instead of writing flash. The data
+ * is copied and the records are appended by this task in order, a full
+ * queue drops them.
+ * The NV work at start up (log recovery, item defaults, settings) is the boot
+ * function given to NvTask_start(), run first in this task.
+ * The stack's own bond writes still go to the driver directly, it reads
+ * them back at once.
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <string.h>
+#include <time.h>
+#include <common/Drivers/NV/nvintf.h>
+#include <common/Drivers/NV/nv_cache.h>
+#include <common/Drivers/NV/nvocmp.h>
+#include <common/Drivers/NV/nv_log.h>
+#include <app_main.h>
+
+/* The deepest path is a compaction from a cache write-through (driver
+ * frames and its 32 byte copy buffers), log appends and the boot work are
+ * shallower. Same as the CLI executor until +NVTASK (AT+NVSTAT) has been
+ * read after compactions on the target. */
+#define APP_NV_THREADSTACKSIZE  1024
+#define APP_NV_LOW_WATER        256     // bytes, a bond record and its CCCs fit
+#define APP_NV_CHECK_PERIOD_MS  1000
+#define APP_NV_QUEUE_LEN        4
+
+typedef struct
+{
+    uint8 logType;          // NV_LOG_xxx
+    uint16 len;             // data bytes
+    uint8 data[NV_LOG_MAX_DATA];
+} NvTask_request_t;
+
+/* NV driver, loaded by the stack (ble_user_config.c) */
+extern NVINTF_nvFuncts_t nvintfFncStruct;
+
+/* === Local Variables ===*/
+static sem_t nvTaskSem;
+static uint8 nvTaskStarted = FALSE;
+static void (*nvBootFxn)(void) = NULL;
+static uint32_t nvFreeAfterCompact = 0;     // 0: no compaction yet
+static uint32_t nvCompactions = 0;
+static uint32_t nvStackFree = APP_NV_THREADSTACKSIZE;    // bytes, lowest seen
+static NVINTF_nvFuncts_t nvCacheFncStruct;     // nvintfFncStruct with the write-back cache
+static pthread_mutex_t nvQueueMutex;
+static NvTask_request_t nvQueue[APP_NV_QUEUE_LEN];
+static uint8 nvQueueHead = 0;
+static uint8 nvQueueCount = 0;
+
+static void NvTask_compactIfLow(void)
+{
+    uint32_t freeNv;
+
+    if (nvintfFncStruct.compactNV == NULL || nvintfFncStruct.expectComp == NULL ||
+        nvintfFncStruct.getFreeNV == NULL)
+    { return; }
+
+    if (!nvintfFncStruct.expectComp(APP_NV_LOW_WATER))
+    { return; }
+
+    // Nothing written since the last compaction, nothing to gain
+    freeNv = nvintfFncStruct.getFreeNV();
+    if (nvFreeAfterCompact != 0 && freeNv >= nvFreeAfterCompact)
+    { return; }
+
+    // Compacts only when less than APP_NV_LOW_WATER bytes are left, and
+    // not at all when every item on the page is still active
+    (void)nvintfFncStruct.compactNV(APP_NV_LOW_WATER);
+
+    nvFreeAfterCompact = nvintfFncStruct.getFreeNV();
+    if (nvFreeAfterCompact > freeNv)
+    { nvCompactions++; }
+}
+
+/* Append the queued log records in order */
+static void NvTask_runQueue(void)
+{
+    NvTask_request_t *pReq;
+
+    while (1)
+    {
+        pthread_mutex_lock(&nvQueueMutex);
+        if (nvQueueCount == 0)
+        {
+            pthread_mutex_unlock(&nvQueueMutex);
+            return;
+        }
+        pReq = &nvQueue[nvQueueHead];
+        pthread_mutex_unlock(&nvQueueMutex);
+
+        // The slot stays taken until the record is written
+        (void)nvLog_append(pReq->logType, pReq->data, pReq->len);
+
+        pthread_mutex_lock(&nvQueueMutex);
+        nvQueueHead = (nvQueueHead + 1) % APP_NV_QUEUE_LEN;
+        nvQueueCount--;
+        pthread_mutex_unlock(&nvQueueMutex);
+    }
+}
+
+static void *NvTask_thread(void *arg0)
+{
+    struct timespec ts;
+
+    if (nvBootFxn != NULL)
+    { nvBootFxn(); }
+
+    while (1)
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += APP_NV_CHECK_PERIOD_MS / 1000;
+        ts.tv_nsec += (APP_NV_CHECK_PERIOD_MS % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+
+        // Kicked, request queued or timed out, check either way
+        sem_timedwait(&nvTaskSem, &ts);
+
+        NvTask_runQueue();
+
+        nvCache_tick();
+        NvTask_compactIfLow();
+
+#if (INCLUDE_uxTaskGetStackHighWaterMark == 1)
+        nvStackFree = uxTaskGetStackHighWaterMark(NULL) * sizeof(StackType_t);
+#endif
+    }
+}
+
+/*
+ * Start the task, NV has to be initialized (stack init done).
+ * Runs at the lowest application priority, below the BLEAppUtil task.
+ * pBootFxn (may be NULL) runs first in the task, requests queued meanwhile
+ * wait for it.
+ */
+bStatus_t NvTask_start(void (*pBootFxn)(void))
+{
+    pthread_t thread;
+    pthread_attr_t attrs;
+    struct sched_param priParam;
+    int retc;
+
+    if (nvTaskStarted)
+    { return SUCCESS; }
+
+    if (sem_init(&nvTaskSem, 0, 0) != 0 ||
+        pthread_mutex_init(&nvQueueMutex, NULL) != 0)
+    { return FAILURE; }
+
+    nvBootFxn = pBootFxn;
+    nvCache_loadApiPtrs(&nvCacheFncStruct, &nvintfFncStruct);
+
+    pthread_attr_init(&attrs);
+    priParam.sched_priority = 1;
+    retc  = pthread_attr_setschedparam(&attrs, &priParam);
+    retc |= pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+    retc |= pthread_attr_setstacksize(&attrs, APP_NV_THREADSTACKSIZE);
+    if (retc != 0)
+    { return FAILURE; }
+
+    if (pthread_create(&thread, &attrs, NvTask_thread, NULL) != 0)
+    { return FAILURE; }
+
+    nvTaskStarted = TRUE;
+    return SUCCESS;
+}
+
+/* Check the free space now, e.g. after a write */
+void NvTask_kick(void)
+{
+    if (nvTaskStarted)
+    { sem_post(&nvTaskSem); }
+}
+
+/* NV functions with the write-back cache, valid once the task is started */
+NVINTF_nvFuncts_t *NvTask_getNvApi(void)
+{
+    return &nvCacheFncStruct;
+}
+
+/* Number of compactions done by the task */
+uint32_t NvTask_getCompactions(void)
+{
+    return nvCompactions;
+}
+
+/* Stack size of the task and the least of it left free so far, in bytes */
+void NvTask_getStack(uint32_t *pSize, uint32_t *pMinFree)
+{
+    *pSize = APP_NV_THREADSTACKSIZE;
+    *pMinFree = nvStackFree;
+}
+
+/*
+ * Append an event log record (nv_log.h) from the NV task. The data is copied,
+ * FAILURE when the task is not started or the queue is full.
+ */
+bStatus_t NvTask_log(uint8 type, const void *pData, uint16 len)
+{
+    NvTask_request_t *pReq;
+
+    if ((len > 0 && pData == NULL) || len > NV_LOG_MAX_DATA)
+    { return INVALIDPARAMETER; }
+
+    if (!nvTaskStarted)
+    { return FAILURE; }
+
+    pthread_mutex_lock(&nvQueueMutex);
+    if (nvQueueCount == APP_NV_QUEUE_LEN)
+    {
+        pthread_mutex_unlock(&nvQueueMutex);
+        return FAILURE;
+    }
+    pReq = &nvQueue[(nvQueueHead + nvQueueCount) % APP_NV_QUEUE_LEN];
+    pReq->logType = type;
+    pReq->len = len;
+    if (len > 0)
+    { memcpy(pReq->data, pData, len); }
+    nvQueueCount++;
+    pthread_mutex_unlock(&nvQueueMutex);
+
+    sem_post(&nvTaskSem);
+    return SUCCESS;
+}
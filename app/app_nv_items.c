@@ -0,0 +1,130 @@
+/******************************************************************************
+
+@file  app_nv_items.c
+
+@brief Build time checks of APP_NV_ITEMS and first boot defaults.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * NvItems_init() looks at every slot of the items with a default once per
+ * boot and writes the default where the stored item is missing, has another
+ * length or another version. The writes go to the driver in batches of
+ * APP_NV_INIT_BATCH, one NV lock each, so a first boot or an upgrade that
+ * bumps a version costs one pass instead of a write per owner.
+ */
+
+#include <common/Drivers/NV/nvintf.h>
+#include <common/Drivers/NV/nvocmp.h>
+#include <app_nv_items.h>
+
+#define APP_NV_INIT_BATCH       4
+
+typedef struct
+{
+    uint16 itemID;
+    uint16 subIDs;
+    uint16 len;
+    uint8  version;
+    const void *pDefault;
+} NvItems_entry_t;
+
+/* NV driver, loaded by the stack (ble_user_config.c) */
+extern NVINTF_nvFuncts_t nvintfFncStruct;
+
+/* The item header has room for the IDs and the length */
+#define APP_NV_CHECK_LIMITS(name, itemID, subIDs, len, version, pDefault) \
+    APP_NV_CHECK(itemID_##name, (itemID) <= NVOCMP_MAXITEMID); \
+    APP_NV_CHECK(subIDs_##name, (subIDs) >= 1 && (subIDs) - 1 <= NVOCMP_MAXSUBID); \
+    APP_NV_CHECK(maxLen_##name, (len) >= 1 && (len) <= NVOCMP_MAXLEN); \
+    APP_NV_CHECK(version_##name, (version) <= 0xFF);
+APP_NV_CHECK(sysID, NVINTF_SYSID_APP <= NVOCMP_MAXSYSID);
+APP_NV_ITEMS(APP_NV_CHECK_LIMITS)
+
+/* A repeated item ID is a repeated enumerator */
+#define APP_NV_ENUM_UNIQUE(name, itemID, subIDs, len, version, pDefault) \
+    APP_NV_UNIQUE_##itemID,
+enum { APP_NV_ITEMS(APP_NV_ENUM_UNIQUE) };
+
+#define APP_NV_TABLE_ENTRY(name, itemID, subIDs, len, version, pDefault) \
+    { (itemID), (subIDs), (len), (version), (pDefault) },
+static const NvItems_entry_t nvItems[APP_NV_ITEM_COUNT] =
+{
+    APP_NV_ITEMS(APP_NV_TABLE_ENTRY)
+};
+
+static uint8 NvItems_write(NVOCMP_batchItem_t *pItems, uint16 count)
+{
+    return (count == 0) ? NVINTF_SUCCESS : NVOCMP_writeBatch(pItems, count);
+}
+
+/* Slot holds an item of the entry's length and version */
+static uint8 NvItems_isValid(const NvItems_entry_t *pEntry, NVINTF_itemID_t id)
+{
+    uint8 version;
+
+    if (nvintfFncStruct.getItemLen(id) != pEntry->len)
+    { return FALSE; }
+
+    return (pEntry->version == 0 ||
+            (nvintfFncStruct.readItem(id, 0, 1, &version) == NVINTF_SUCCESS &&
+             version == pEntry->version));
+}
+
+/*
+ * Write the defaults of items which are missing or stale, see above.
+ * NV is ready once the stack init is done, call before the owners read.
+ */
+uint8 NvItems_init(void)
+{
+    NVOCMP_batchItem_t writes[APP_NV_INIT_BATCH];
+    NVINTF_itemID_t id = { NVINTF_SYSID_APP, 0, 0 };
+    const NvItems_entry_t *pEntry;
+    uint16 count = 0;
+    uint8 status = NVINTF_SUCCESS;
+    uint8 result;
+    uint8 item;
+
+    if (nvintfFncStruct.getItemLen == NULL || nvintfFncStruct.readItem == NULL)
+    { return NVINTF_NOTREADY; }
+
+    for (item = 0; item < APP_NV_ITEM_COUNT; item++)
+    {
+        pEntry = &nvItems[item];
+        if (pEntry->pDefault == NULL)
+        { continue; }
+
+        id.itemID = pEntry->itemID;
+        for (id.subID = 0; id.subID < pEntry->subIDs; id.subID++)
+        {
+            if (NvItems_isValid(pEntry, id))
+            { continue; }
+
+            writes[count].id = id;
+            writes[count].len = pEntry->len;
+            writes[count].buffer = (void *)pEntry->pDefault;
+            writes[count].status = NVINTF_FAILURE;
+            if (++count == APP_NV_INIT_BATCH)
+            {
+                result = NvItems_write(writes, count);
+                if (status == NVINTF_SUCCESS)
+                { status = result; }
+                count = 0;
+            }
+        }
+    }
+
+    result = NvItems_write(writes, count);
+    if (status == NVINTF_SUCCESS)
+    { status = result; }
+
+    return status;
+}
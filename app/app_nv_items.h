@@ -0,0 +1,68 @@
+/******************************************************************************
+
+@file  app_nv_items.h
+
+@brief The application's NV items (NVINTF_SYSID_APP), in one table.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * Each APP_NV_ITEMS entry is one item ID:
+ *     X(name, itemID, subIDs, len, version, pDefault)
+ * subIDs   items with subID 0 .. subIDs - 1 (slots)
+ * len      item length. An item with a default is always this long, an item
+ *          without one (NULL) holds up to len bytes.
+ * version  first byte of an item with a default, 0: not versioned
+ * pDefault written by NvItems_init() to each slot that is missing, has
+ *          another length or another version
+ *
+ * IDs, lengths and slot counts are checked against the NVOCMP header limits
+ * at build time (app_nv_items.c), and each owner checks its struct with
+ * APP_NV_CHECK_LEN(). Spell item IDs with 4 hex digits, a repeated ID then
+ * does not build either.
+ * NvItems_init() runs when the stack init is done, so owners read an item
+ * with a default straight away, without asking its length first.
+ */
+
+#ifndef APP_NV_ITEMS_H_
+#define APP_NV_ITEMS_H_
+
+#include <common/Drivers/NV/nvintf.h>
+#include <app_main.h>
+
+#define APP_NV_ITEMS(X) \
+    /* name,    itemID, subIDs, len, version,              pDefault */ \
+    X(SETTINGS, 0x0001, 1,      16,  APP_SETTINGS_VERSION, &appSettingsDefault) \
+    X(SCRIPT,   0x0002, 4,      248, 0,                    NULL)
+
+/* Defaults used in APP_NV_ITEMS */
+extern const App_settings appSettingsDefault;
+
+/* APP_NV_ITEM_<name>: index in the table */
+#define APP_NV_ENUM_INDEX(name, itemID, subIDs, len, version, pDefault) \
+    APP_NV_ITEM_##name,
+enum { APP_NV_ITEMS(APP_NV_ENUM_INDEX) APP_NV_ITEM_COUNT };
+
+/* APP_NV_ITEMID_<name>, APP_NV_SUBIDS_<name>, APP_NV_LEN_<name> */
+#define APP_NV_ENUM_PARAMS(name, itemID, subIDs, len, version, pDefault) \
+    APP_NV_ITEMID_##name = (itemID), APP_NV_SUBIDS_##name = (subIDs), APP_NV_LEN_##name = (len),
+enum { APP_NV_ITEMS(APP_NV_ENUM_PARAMS) };
+
+/* NVINTF_itemID_t of slot sub of the item */
+#define APP_NV_ID(name, sub)    ((NVINTF_itemID_t){ NVINTF_SYSID_APP, APP_NV_ITEMID_##name, (sub) })
+
+/* Does not build unless cond holds, at file scope */
+#define APP_NV_CHECK(tag, cond)         typedef char appNvCheck_##tag[(cond) ? 1 : -1]
+#define APP_NV_CHECK_LEN(name, size)    APP_NV_CHECK(len_##name, (size) == APP_NV_LEN_##name)
+
+uint8 NvItems_init(void);
+
+#endif /* APP_NV_ITEMS_H_ */
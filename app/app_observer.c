@@ -36,10 +36,12 @@ $Release Date: PACKAGE RELEASE DATE $
 //*****************************************************************************
 //! Includes
 //*****************************************************************************
+#include <stdio.h>
 #include <string.h>
 #include "ti_ble_config.h"
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
 #include <common/MenuModule/menu_module.h>
+#include <common/FreeRTOSCli/cli_api.h>
 #include <app_main.h>
 
 //*****************************************************************************
@@ -48,6 +50,43 @@ $Release Date: PACKAGE RELEASE DATE $
 
 void Observer_ScanEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData);
 void Observer_addScanRes(GapScan_Evt_AdvRpt_t *pScanRpt);
+void Observer_scanSummary(char *pData);
+uint8_t Observer_scanFilter(GapScan_Evt_AdvRpt_t *pReport);
+void Observer_scanStreamReport(GapScan_Evt_AdvRpt_t *pReport);
+static void Observer_scanStreamBegin(char *pData);
+static void Observer_scanStreamRun(char *pData);
+static void Observer_scanStreamHalt(char *pData);
+static void Observer_scanStreamDone(void);
+
+//*****************************************************************************
+//! Defines
+//*****************************************************************************
+
+// Period of the scan table summary, in ms
+#ifndef OBSERVER_SCAN_SUMMARY_PERIOD
+#define OBSERVER_SCAN_SUMMARY_PERIOD    5000
+#endif
+
+// Max adv data bytes printed per scan stream record
+#define OBSERVER_STREAM_MAX_DATA        31
+
+// "+SCAN:" addr "," type "," rssi "," data "\r\n"
+#define OBSERVER_STREAM_RECORD_LEN      (6 + 2*B_ADDR_LEN + 1 + 3 + 1 + 4 + 1 + \
+                                         2*OBSERVER_STREAM_MAX_DATA + 3)
+
+// "\r\n+SCANDONE:" count "," dropped "\r\n", and the length byte in the URC ring
+#define OBSERVER_DONE_RECORD_LEN        (2 + 10 + 10 + 1 + 10 + 2 + 1)
+
+//*****************************************************************************
+//! Typedefs
+//*****************************************************************************
+
+// AT+BLESCAN request, passed from the CLI to the BLEAppUtil task
+typedef struct
+{
+    uint16 duration;            // Scan duration in seconds
+    App_scanFilter filter;      // Filters to apply to the adv reports
+} Observer_streamReq_t;
 
 //*****************************************************************************
 //! Globals
@@ -118,6 +157,22 @@ const BLEAppUtil_ScanStart_t observerScanStartParams =
 static App_scanResults observerScanRes[APP_MAX_NUM_OF_ADV_REPORTS] = {0};
 static uint8 observerScanIndex = 0;
 
+// Scan stream state, see Observer_scanStreamStart
+static App_scanFilter observerScanFilter;
+static BLEAppUtil_ScanStart_t observerStreamStartParams =
+{
+    .scanPeriod     = 0,
+    .scanDuration   = 0,
+    .maxNumReport   = 0
+};
+// AT+BLESCAN request, applied in the BLEAppUtil task while the scan is stopped
+static Observer_streamReq_t observerStreamReq;
+static uint8 observerScanning = FALSE;
+static uint8 observerStreaming = FALSE;
+static uint8 observerStreamPending = FALSE;
+static uint32 observerStreamCount = 0;
+static uint32 observerStreamDropped = 0;
+
 //*****************************************************************************
 //! Functions
 //*****************************************************************************
@@ -139,16 +194,27 @@ void Observer_ScanEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
     BLEAppUtil_ScanEventData_t *scanMsg = (BLEAppUtil_ScanEventData_t *)pMsgData;
     switch (event)
     {
-        /*! This event happens after detecting peer, an event for each peer */
+        /*! This event happens after detecting a new peer, or a peer whose
+         *  adv data changed. Duplicates are dropped by the scan table */
         case BLEAPPUTIL_ADV_REPORT:
         {
-            MenuModule_printf(APP_MENU_SCAN_EVENT, 0, "Scan status: Adv report");
+            MenuModule_printf(APP_MENU_SCAN_EVENT, 0, "Scan status: Adv report - "
+                              "Addr: " MENU_MODULE_COLOR_YELLOW "%s " MENU_MODULE_COLOR_RESET
+                              "RSSI: " MENU_MODULE_COLOR_YELLOW "%d" MENU_MODULE_COLOR_RESET,
+                              BLEAppUtil_convertBdAddr2Str(scanMsg->pBuf->pAdvReport.addr),
+                              scanMsg->pBuf->pAdvReport.rssi);
+
+            if(observerStreaming)
+            {
+                Observer_scanStreamReport(&scanMsg->pBuf->pAdvReport);
+            }
 
             break;
         }
 
         case BLEAPPUTIL_SCAN_ENABLED:
         {
+            observerScanning = TRUE;
             MenuModule_printf(APP_MENU_SCAN_EVENT, 0, "Scan status: Scan started...");
 
             break;
@@ -158,6 +224,26 @@ void Observer_ScanEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
         {
             uint8 i;
 
+            observerScanning = FALSE;
+            if(observerStreamPending)
+            {
+                // The previous scan was stopped to start the stream, the
+                // stream is started from the BLEAppUtil task
+                observerStreamPending = FALSE;
+                if(BLEAppUtil_invokeFunctionNoData(Observer_scanStreamRun) == SUCCESS)
+                {
+                    break;
+                }
+                // Tell the host the stream did not start
+                observerStreaming = TRUE;
+                observerStreamCount = 0;
+                observerStreamDropped = 0;
+            }
+            if(observerStreaming)
+            {
+                Observer_scanStreamDone();
+            }
+
             for(int i = 0; i < APP_MAX_NUM_OF_ADV_REPORTS; i++)
             {
                 memset(&observerScanRes[i], 0, sizeof(App_scanResults));
@@ -208,6 +294,319 @@ void Observer_addScanRes(GapScan_Evt_AdvRpt_t *pScanRpt)
     }
 }
 
+/*********************************************************************
+ * @fn      Observer_scanSummary
+ *
+ * @brief   Print the periodic summary of the scan table. Called from
+ *          the BLEAppUtil context.
+ *
+ * @param   pData - the BLEAppUtil_ScanSummary_t of the last period
+ *
+ * @return  none
+ */
+void Observer_scanSummary(char *pData)
+{
+    BLEAppUtil_ScanSummary_t *pSummary = (BLEAppUtil_ScanSummary_t *)pData;
+
+    MenuModule_printf(APP_MENU_SCAN_EVENT, 0, "Scan status: Devices: "
+                      MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET
+                      "New: " MENU_MODULE_COLOR_YELLOW "%d " MENU_MODULE_COLOR_RESET
+                      "Reports: " MENU_MODULE_COLOR_YELLOW "%d/%d " MENU_MODULE_COLOR_RESET
+                      "Full: " MENU_MODULE_COLOR_YELLOW "%d" MENU_MODULE_COLOR_RESET,
+                      pSummary->numDevices, pSummary->numNew,
+                      pSummary->numForwarded, pSummary->numReports,
+                      pSummary->numTableFull);
+}
+
+/*********************************************************************
+ * @fn      Observer_scanFilter
+ *
+ * @brief   Apply the scan stream filters to an adv report. Registered
+ *          with BLEAppUtil_registerScanFilter, so it runs in the stack
+ *          context before the report is queued.
+ *
+ * @param   pReport - the adv report
+ *
+ * @return  TRUE if the report matches all the active filters
+ */
+uint8_t Observer_scanFilter(GapScan_Evt_AdvRpt_t *pReport)
+{
+    uint8 flags = observerScanFilter.flags;
+    uint8 found = 0;
+    uint16 i = 0;
+
+    if((flags & APP_SCAN_FILTER_RSSI) && (pReport->rssi < observerScanFilter.minRssi))
+    {
+        return FALSE;
+    }
+
+    // Walk the AD structures: length, type, data
+    while(pReport->pData != NULL && (i + 1) < pReport->dataLen)
+    {
+        uint8 adLen = pReport->pData[i];
+        uint8 adType = pReport->pData[i + 1];
+        uint8 *pAd = &pReport->pData[i + 2];
+        uint16 j;
+
+        if(adLen == 0 || (i + 1 + adLen) > pReport->dataLen)
+        {
+            break;
+        }
+        adLen--;  // data only
+
+        switch(adType)
+        {
+            case GAP_ADTYPE_LOCAL_NAME_SHORT:
+            case GAP_ADTYPE_LOCAL_NAME_COMPLETE:
+                if((flags & APP_SCAN_FILTER_NAME) &&
+                   adLen >= observerScanFilter.nameLen &&
+                   memcmp(pAd, observerScanFilter.namePrefix, observerScanFilter.nameLen) == 0)
+                {
+                    found |= APP_SCAN_FILTER_NAME;
+                }
+                break;
+
+            case GAP_ADTYPE_16BIT_MORE:
+            case GAP_ADTYPE_16BIT_COMPLETE:
+                for(j = 0; (j + 1) < adLen; j += 2)
+                {
+                    if(BUILD_UINT16(pAd[j], pAd[j + 1]) == observerScanFilter.uuid)
+                    {
+                        found |= APP_SCAN_FILTER_UUID;
+                    }
+                }
+                break;
+
+            case GAP_ADTYPE_SERVICE_DATA:
+                if(adLen >= 2 && BUILD_UINT16(pAd[0], pAd[1]) == observerScanFilter.uuid)
+                {
+                    found |= APP_SCAN_FILTER_UUID;
+                }
+                break;
+
+            case GAP_ADTYPE_MANUFACTURER_SPECIFIC:
+                if(adLen >= 2 && BUILD_UINT16(pAd[0], pAd[1]) == observerScanFilter.mfgId)
+                {
+                    found |= APP_SCAN_FILTER_MFG;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        i += pReport->pData[i] + 1;
+    }
+
+    flags &= (APP_SCAN_FILTER_NAME | APP_SCAN_FILTER_UUID | APP_SCAN_FILTER_MFG);
+
+    return ((found & flags) == flags) ? TRUE : FALSE;
+}
+
+/*********************************************************************
+ * @fn      Observer_scanStreamReport
+ *
+ * @brief   Queue an adv report for the CLI UART as a compact record:
+ *          +SCAN:<addr>,<addrType>,<rssi>,<adv data hex>
+ *          Records which do not fit in the URC ring are dropped and
+ *          counted in +SCANDONE.
+ *
+ * @param   pReport - the adv report
+ *
+ * @return  none
+ */
+void Observer_scanStreamReport(GapScan_Evt_AdvRpt_t *pReport)
+{
+    static char record[OBSERVER_STREAM_RECORD_LEN];
+    uint16 dataLen = (pReport->pData != NULL) ? pReport->dataLen : 0;
+    uint16 i;
+    int len;
+
+    if(dataLen > OBSERVER_STREAM_MAX_DATA)
+    {
+        dataLen = OBSERVER_STREAM_MAX_DATA;
+    }
+
+    len = sprintf(record, "+SCAN:%02X%02X%02X%02X%02X%02X,%d,%d,",
+                  pReport->addr[5], pReport->addr[4], pReport->addr[3],
+                  pReport->addr[2], pReport->addr[1], pReport->addr[0],
+                  pReport->addrType, pReport->rssi);
+    for(i = 0; i < dataLen; i++)
+    {
+        len += sprintf(&record[len], "%02X", pReport->pData[i]);
+    }
+    record[len++] = '\r';
+    record[len++] = '\n';
+
+    // Written out by the CLI executor thread, the scan never waits for the UART.
+    // The room for +SCANDONE is kept free, so the end of the stream is not lost.
+    if(cli_urcRecordSpace() >= (size_t)len + 1 + OBSERVER_DONE_RECORD_LEN &&
+       cli_urcPostRecord(record, len) == SUCCESS)
+    {
+        observerStreamCount++;
+    }
+    else
+    {
+        observerStreamDropped++;
+    }
+}
+
+/*********************************************************************
+ * @fn      Observer_scanStreamStart
+ *
+ * @brief   Scan for duration seconds and print the matching adv reports
+ *          to the CLI UART. A running scan is restarted. Called from the
+ *          CLI, the scan is started from the BLEAppUtil task and a failed
+ *          start is reported with +SCANDONE:0,0.
+ *
+ * @param   duration - scan duration in seconds
+ * @param   pFilter  - filters to apply to the adv reports
+ *
+ * @return  SUCCESS, errorInfo
+ */
+bStatus_t Observer_scanStreamStart(uint16 duration, const App_scanFilter *pFilter)
+{
+    bStatus_t status;
+    Observer_streamReq_t *pReq;
+
+    // Scan duration is in units of 10ms
+    if(duration == 0 || duration > (0xFFFF / 100) || pFilter == NULL)
+    {
+        return INVALIDPARAMETER;
+    }
+
+    pReq = ICall_malloc(sizeof(Observer_streamReq_t));
+    if(pReq == NULL)
+    {
+        return bleMemAllocError;
+    }
+    pReq->duration = duration;
+    pReq->filter = *pFilter;
+
+    status = BLEAppUtil_invokeFunction(Observer_scanStreamBegin, (char *)pReq);
+    if(status != SUCCESS)
+    {
+        ICall_free(pReq);
+    }
+
+    return status;
+}
+
+/*********************************************************************
+ * @fn      Observer_scanStreamStop
+ *
+ * @brief   Stop the scan started by Observer_scanStreamStart. Called from
+ *          the CLI, the scan is stopped from the BLEAppUtil task.
+ *
+ * @return  SUCCESS, errorInfo
+ */
+bStatus_t Observer_scanStreamStop(void)
+{
+    return BLEAppUtil_invokeFunctionNoData(Observer_scanStreamHalt);
+}
+
+/*********************************************************************
+ * @fn      Observer_scanStreamBegin
+ *
+ * @brief   Take an AT+BLESCAN request, called from the BLEAppUtil task.
+ *          A running scan is stopped first and the stream is started
+ *          from its scan disabled event, so the stream state is never
+ *          changed while reports are coming.
+ *
+ * @param   pData - the Observer_streamReq_t
+ *
+ * @return  none
+ */
+static void Observer_scanStreamBegin(char *pData)
+{
+    observerStreamReq = *(Observer_streamReq_t *)pData;
+
+    if(observerScanning)
+    {
+        // Restart from the scan disabled event
+        observerStreamPending = TRUE;
+        if(BLEAppUtil_scanStop() != SUCCESS)
+        {
+            observerStreamPending = FALSE;
+            observerStreaming = TRUE;
+            observerStreamCount = 0;
+            observerStreamDropped = 0;
+            Observer_scanStreamDone();
+        }
+    }
+    else
+    {
+        Observer_scanStreamRun(NULL);
+    }
+}
+
+/*********************************************************************
+ * @fn      Observer_scanStreamRun
+ *
+ * @brief   Install the filter of the request and start the stream scan,
+ *          called from the BLEAppUtil task while the scan is stopped.
+ *
+ * @param   pData - not used
+ *
+ * @return  none
+ */
+static void Observer_scanStreamRun(char *pData)
+{
+    // Install the filter before the scan can deliver reports
+    observerScanFilter = observerStreamReq.filter;
+    BLEAppUtil_registerScanFilter(Observer_scanFilter);
+
+    observerStreamStartParams.scanDuration = observerStreamReq.duration * 100;
+    observerStreamCount = 0;
+    observerStreamDropped = 0;
+    observerStreaming = TRUE;
+
+    if(BLEAppUtil_scanStart(&observerStreamStartParams) != SUCCESS)
+    {
+        Observer_scanStreamDone();
+    }
+}
+
+/*********************************************************************
+ * @fn      Observer_scanStreamHalt
+ *
+ * @brief   Stop the stream scan, called from the BLEAppUtil task.
+ *          +SCANDONE is sent from the scan disabled event.
+ *
+ * @param   pData - not used
+ *
+ * @return  none
+ */
+static void Observer_scanStreamHalt(char *pData)
+{
+    observerStreamPending = FALSE;
+    if(observerStreaming)
+    {
+        BLEAppUtil_scanStop();
+    }
+}
+
+/*********************************************************************
+ * @fn      Observer_scanStreamDone
+ *
+ * @brief   End the stream and queue +SCANDONE:<count>,<dropped> behind
+ *          the last records. The reports leave room for it in the URC
+ *          ring, if it is still lost it is counted in the URC drops.
+ *
+ * @return  none
+ */
+static void Observer_scanStreamDone(void)
+{
+    char doneStr[OBSERVER_DONE_RECORD_LEN];
+    int len;
+
+    observerStreaming = FALSE;
+    BLEAppUtil_registerScanFilter(NULL);
+    len = sprintf(doneStr, "\r\n+SCANDONE:%u,%u\r\n", (unsigned int)observerStreamCount,
+                  (unsigned int)observerStreamDropped);
+    cli_urcPostRecord(doneStr, len);
+}
+
 /*********************************************************************
  * @fn      Scan_getScanResList
  *
@@ -252,6 +651,14 @@ bStatus_t Observer_start()
         return(status);
     }
 
+    // Only forward new or changed devices, with a periodic summary
+    status = BLEAppUtil_scanTableInit(Observer_scanSummary, OBSERVER_SCAN_SUMMARY_PERIOD);
+    if(status != SUCCESS)
+    {
+        // Return status value
+        return(status);
+    }
+
     status = BLEAppUtil_scanStart(&observerScanStartParams);
     if(status != SUCCESS)
     {
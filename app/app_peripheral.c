@@ -47,6 +47,7 @@ $Release Date: PACKAGE RELEASE DATE $
 //*****************************************************************************
 void Peripheral_AdvEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData);
 void Peripheral_GAPConnEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData);
+static void Peripheral_updateAdv(char *pData);
 
 //*****************************************************************************
 //! Globals
@@ -143,6 +144,9 @@ void Peripheral_AdvEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
  * @brief   The purpose of this function is to handle connection related
  *          events that rise from the GAP and were registered in
  *          @ref BLEAppUtil_registerEventHandler
+ *          This may run in the stack context (BLEAPPUTIL_DIRECT_STACK_DISPATCH),
+ *          advertising is restarted from the BLEAppUtil task with
+ *          @ref BLEAppUtil_invokeFunction.
  *
  * @param   event - message event.
  * @param   pMsgData - pointer to message data.
@@ -154,24 +158,9 @@ void Peripheral_GAPConnEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
     switch(event)
     {
         case BLEAPPUTIL_LINK_ESTABLISHED_EVENT:
-        {
-            /* Check if we reach the maximum allowed number of connections */
-            if(linkDB_NumActive() < linkDB_NumConns())
-            {
-                /* Start advertising since there is room for more connections */
-                BLEAppUtil_advStart(peripheralAdvHandle_1, &advSetStartParamsSet_1);
-            }
-            else
-            {
-                /* Stop advertising since there is no room for more connections */
-                BLEAppUtil_advStop(peripheralAdvHandle_1);
-            }
-            break;
-        }
-
         case BLEAPPUTIL_LINK_TERMINATED_EVENT:
         {
-            BLEAppUtil_advStart(peripheralAdvHandle_1, &advSetStartParamsSet_1);
+            BLEAppUtil_invokeFunctionNoData(Peripheral_updateAdv);
             break;
         }
 
@@ -182,6 +171,32 @@ void Peripheral_GAPConnEventHandler(uint32 event, BLEAppUtil_msgHdr_t *pMsgData)
     }
 }
 
+/*********************************************************************
+ * @fn      Peripheral_updateAdv
+ *
+ * @brief   Advertise while there is room for more connections, called
+ *          from the BLEAppUtil task after a link is established or
+ *          terminated
+ *
+ * @param   pData - not used
+ *
+ * @return  none
+ */
+static void Peripheral_updateAdv(char *pData)
+{
+    /* Check if we reach the maximum allowed number of connections */
+    if(linkDB_NumActive() < linkDB_NumConns())
+    {
+        /* Start advertising since there is room for more connections */
+        BLEAppUtil_advStart(peripheralAdvHandle_1, &advSetStartParamsSet_1);
+    }
+    else
+    {
+        /* Stop advertising since there is no room for more connections */
+        BLEAppUtil_advStop(peripheralAdvHandle_1);
+    }
+}
+
 /*********************************************************************
  * @fn      Peripheral_start
  *
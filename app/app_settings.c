@@ -0,0 +1,207 @@
+/******************************************************************************
+
+@file  app_settings.c
+
+@brief Settings changed over AT, kept in one NV item (AT&W / AT&F).
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * appSettings is the active profile. The AT handlers update it together with
+ * the setting itself, AT&W writes it to NV, and it is read back and applied
+ * when the stack init is done, before anything starts advertising.
+ * The item is APP_NV_ITEMS SETTINGS: one with another version or size is
+ * replaced by the factory defaults at boot (NvItems_init).
+ * It goes through the NV write-back cache (NvTask_getNvApi), which drops
+ * writes of unchanged content, and AT&W flushes it: the host is only told OK
+ * once the settings are in flash.
+ * The AT handlers run in the CLI executor, the load in the NV task and the
+ * apply in the BLEAppUtil task: appSettings is only accessed between
+ * Settings_lock() and Settings_unlock(), a short critical section, and the
+ * NV and stack calls are made on a copy.
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <string.h>
+#include <common/BLEAppUtil/inc/bleapputil_api.h>
+#include <common/Drivers/NV/nvintf.h>
+#include <common/Drivers/NV/nv_cache.h>
+#include <common/FreeRTOSCli/cli_api.h>
+#include <app_main.h>
+#include <app_nv_items.h>
+
+APP_NV_CHECK_LEN(SETTINGS, sizeof(App_settings));
+
+const App_settings appSettingsDefault =
+{
+     .version   = APP_SETTINGS_VERSION,
+     .echo      = CLI_UART_ECHO,
+     .urcMask   = CLI_URC_ALL,
+     .advOnBoot = FALSE,
+     .advIntMin = 0,    // 0: keep the SysConfig interval
+     .advIntMax = 0,
+     .txPower   = APP_TXPOWER_NOT_SET,
+     .advTxPower = APP_TXPOWER_NOT_SET
+};
+
+static App_settings appSettings;
+static App_settings appSettingsStored;  // last written or read, skips writes of the same data
+static uint8 appSettingsLoaded = FALSE;
+
+static const NVINTF_itemID_t appSettingsId =
+{
+     .systemID = NVINTF_SYSID_APP,
+     .itemID   = APP_NV_ITEMID_SETTINGS,
+     .subID    = 0
+};
+
+/* The first error of a sequence, the later steps are still done */
+static bStatus_t Settings_firstError(bStatus_t status, bStatus_t next)
+{
+    return (status != SUCCESS) ? status : next;
+}
+
+/* Take the settings, the factory defaults until they are loaded. Nests. */
+void Settings_lock(void)
+{
+    taskENTER_CRITICAL();
+    if (!appSettingsLoaded)
+    {
+        appSettings = appSettingsDefault;
+        appSettingsStored = appSettingsDefault;
+        appSettingsLoaded = TRUE;
+    }
+}
+
+void Settings_unlock(void)
+{
+    taskEXIT_CRITICAL();
+}
+
+/* The active profile, between Settings_lock() and Settings_unlock() only */
+App_settings *Settings_get(void)
+{
+    return &appSettings;
+}
+
+/*
+ * Read the stored settings, factory defaults when there are none.
+ * NvItems_init() has checked the item's length, and the NV task has to be
+ * started for the cache.
+ */
+bStatus_t Settings_load(void)
+{
+    NVINTF_nvFuncts_t *pNv = NvTask_getNvApi();
+    App_settings stored;
+    bStatus_t status = SUCCESS;
+
+    if (pNv->readItem == NULL)
+    { return FAILURE; }
+
+    (void)nvCache_addItem(appSettingsId);
+
+    if (pNv->readItem(appSettingsId, 0, sizeof(App_settings), &stored) != NVINTF_SUCCESS ||
+        stored.version != APP_SETTINGS_VERSION)
+    {
+        stored = appSettingsDefault;
+        status = FAILURE;
+    }
+
+    Settings_lock();
+    appSettings = stored;
+    appSettingsStored = stored;
+    Settings_unlock();
+
+    return status;
+}
+
+/* Write the active profile, unless NV already holds the same data */
+bStatus_t Settings_save(void)
+{
+    NVINTF_nvFuncts_t *pNv = NvTask_getNvApi();
+    uint8 advOnBoot = (Monitor_getState(APP_MONITOR_STATE_ADV_ON_OFF) == MONITOR_ADV_ON);
+    App_settings settings;
+    uint8 unchanged;
+
+    Settings_lock();
+    appSettings.version = APP_SETTINGS_VERSION;
+    appSettings.advOnBoot = advOnBoot;
+    settings = appSettings;
+    unchanged = (memcmp(&appSettings, &appSettingsStored, sizeof(App_settings)) == 0);
+    Settings_unlock();
+
+    if (unchanged &&
+        pNv->getItemLen != NULL &&
+        pNv->getItemLen(appSettingsId) == sizeof(App_settings))
+    { return SUCCESS; }
+
+    if (pNv->writeItem == NULL ||
+        pNv->writeItem(appSettingsId, sizeof(App_settings), &settings) != NVINTF_SUCCESS ||
+        nvCache_flush() != NVINTF_SUCCESS)
+    { return FAILURE; }
+
+    Settings_lock();
+    appSettingsStored = settings;
+    Settings_unlock();
+
+    NvTask_kick();
+    return SUCCESS;
+}
+
+/* Back to the factory defaults, AT&W stores them */
+bStatus_t Settings_factoryReset(void)
+{
+    Settings_lock();
+    appSettings = appSettingsDefault;
+    Settings_unlock();
+
+    return Settings_apply(FALSE);
+}
+
+/*
+ * Push the active profile to the CLI and the stack. Advertising is only
+ * started at boot (startAdv), never by AT&F. Returns the first error, the
+ * other settings are still applied.
+ */
+bStatus_t Settings_apply(uint8 startAdv)
+{
+    bStatus_t status = SUCCESS;
+    App_settings settings;
+
+    Settings_lock();
+    settings = appSettings;
+    Settings_unlock();
+
+    status = cli_uartSetEchoOnOff(settings.echo);
+    cli_urcSetMask(settings.urcMask);
+
+    if (settings.txPower != APP_TXPOWER_NOT_SET)
+    { status = Settings_firstError(status, TxPower_setDefault(settings.txPower)); }
+
+#if defined( HOST_CONFIG ) && ( HOST_CONFIG & ( PERIPHERAL_CFG ) )
+    if (settings.advIntMin != 0 && settings.advIntMax != 0)
+    {
+        status = Settings_firstError(status, Peripheral_setAdvParam(GAP_ADV_PARAM_PRIMARY_INTERVAL_MIN,
+                                                                    &settings.advIntMin));
+        status = Settings_firstError(status, Peripheral_setAdvParam(GAP_ADV_PARAM_PRIMARY_INTERVAL_MAX,
+                                                                    &settings.advIntMax));
+    }
+
+    if (settings.advTxPower != APP_TXPOWER_NOT_SET)
+    { status = Settings_firstError(status, TxPower_setAdv(Peripheral_getAdvHandle(), settings.advTxPower)); }
+
+    if (startAdv && settings.advOnBoot)
+    { status = Settings_firstError(status, Peripheral_advStart()); }
+#endif
+
+    return status;
+}
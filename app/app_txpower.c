@@ -0,0 +1,80 @@
+/******************************************************************************
+
+@file  app_txpower.c
+
+@brief TX power: default for the device and per advertising set.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * Valid levels are the dBm entries of LRF_txPowerTableBle (SysConfig,
+ * Startup/rcl_settings_ble.c), other values are refused instead of being
+ * rounded by the radio.
+ */
+
+#include "rcl_settings_ble.h"
+#include <common/BLEAppUtil/inc/bleapputil_api.h>
+#include <app_main.h>
+
+static int8 txPowerDefault = APP_TXPOWER_NOT_SET;
+
+/* Copy the supported levels, lowest first, returns the number of levels */
+uint8 TxPower_getLevels(int8 *pLevels, uint8 maxLevels)
+{
+    uint8 i;
+
+    for (i = 0; i < LRF_txPowerTableBle.numEntries && i < maxLevels; i++)
+    {
+        pLevels[i] = LRF_txPowerTableBle.powerTable[i].power.dBm;
+    }
+    return i;
+}
+
+uint8 TxPower_isSupported(int8 dBm)
+{
+    uint32 i;
+
+    for (i = 0; i < LRF_txPowerTableBle.numEntries; i++)
+    {
+        if (LRF_txPowerTableBle.powerTable[i].power.dBm == dBm &&
+            LRF_txPowerTableBle.powerTable[i].power.fraction == 0)
+        { return TRUE; }
+    }
+    return FALSE;
+}
+
+/* Default for everything without its own level, e.g. connections */
+bStatus_t TxPower_setDefault(int8 dBm)
+{
+    if (!TxPower_isSupported(dBm))
+    { return INVALIDPARAMETER; }
+
+    if (HCI_EXT_SetTxPowerDbmCmd(dBm, 0) != SUCCESS)
+    { return FAILURE; }
+
+    txPowerDefault = dBm;
+    return SUCCESS;
+}
+
+/* APP_TXPOWER_NOT_SET until set, the stack default is used */
+int8 TxPower_getDefault(void)
+{
+    return txPowerDefault;
+}
+
+/* Level of one advertising set, taken into account when it is enabled again */
+bStatus_t TxPower_setAdv(uint8 advHandle, int8 dBm)
+{
+    if (!TxPower_isSupported(dBm))
+    { return INVALIDPARAMETER; }
+
+    return BLEAppUtil_setAdvParam(advHandle, GAP_ADV_PARAM_TX_POWER, &dBm);
+}
@@ -20,6 +20,7 @@ $Release Date: PACKAGE RELEASE DATE $
  */
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
 #include <ti/bleapp/ble_app_util/inc/bleapputil_internal.h>
+#include <common/BLEAppUtil/inc/bleapputil_heap.h>
 #include "ble_stack_api.h"
 #include <app_main.h>
 
@@ -0,0 +1,590 @@
+/******************************************************************************
+
+@file  bleapputil_scan_table.c
+
+@brief This file contains the BLEAppUtil module scan deduplication table.
+       Adv reports are looked up in a fixed-size open-addressing hash table
+       keyed by address and address type, so that only new devices and
+       devices with changed adv data are forwarded to the application.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <common/BLEAppUtil/inc/bleapputil_local.h>
+#include <common/BLEAppUtil/inc/bleapputil_heap.h>
+
+/*********************************************************************
+ * MACROS
+ */
+// Number of entries in the table, must be a power of 2
+#ifndef BLEAPPUTIL_SCAN_TABLE_SIZE
+#define BLEAPPUTIL_SCAN_TABLE_SIZE          32
+#endif
+
+// A report with unchanged adv data is forwarded again when its RSSI moved
+// by at least this many dB since the last forwarded report. 0 disables it.
+#ifndef BLEAPPUTIL_SCAN_TABLE_RSSI_DELTA
+#define BLEAPPUTIL_SCAN_TABLE_RSSI_DELTA    10
+#endif
+
+// Devices not seen for this long (ms) are removed when a summary is made
+#ifndef BLEAPPUTIL_SCAN_TABLE_AGE_OUT
+#define BLEAPPUTIL_SCAN_TABLE_AGE_OUT       30000
+#endif
+
+#if (BLEAPPUTIL_SCAN_TABLE_SIZE & (BLEAPPUTIL_SCAN_TABLE_SIZE - 1)) != 0
+#error "BLEAPPUTIL_SCAN_TABLE_SIZE must be a power of 2"
+#endif
+
+#define BLEAPPUTIL_SCAN_TABLE_MASK          (BLEAPPUTIL_SCAN_TABLE_SIZE - 1)
+
+// FNV-1a parameters
+#define BLEAPPUTIL_FNV_OFFSET               0x811C9DC5UL
+#define BLEAPPUTIL_FNV_PRIME                0x01000193UL
+
+/*********************************************************************
+* TYPEDEFS
+*/
+typedef struct
+{
+    BLEAppUtil_ScanDevice_t device;     // count == 0 marks a free entry
+    int8_t                  rssiFwd;    // RSSI of the last forwarded report
+} BLEAppUtil_ScanTableEntry_t;
+
+/*********************************************************************
+* LOCAL VARIABLES
+*/
+static BLEAppUtil_ScanTableEntry_t scanTable[BLEAPPUTIL_SCAN_TABLE_SIZE];
+static BLEAppUtil_ScanSummary_t scanTableSummary;
+static InvokeFromBLEAppUtilContext_t scanTableSummaryCB = NULL;
+static uint32_t scanTableSummaryTicks = 0;
+static uint32_t scanTableAgeOutTicks = 0;
+static uint32_t scanTableLastSummary = 0;
+static uint8_t scanTableEnabled = FALSE;
+static BLEAppUtil_ScanFilter_t scanTableFilter = NULL;
+
+/*********************************************************************
+* LOCAL FUNCTIONS
+*/
+static uint32_t BLEAppUtil_scanTableHash(uint32_t hash, const uint8_t *pData, uint16_t len);
+static uint8_t BLEAppUtil_scanTableHome(const BLEAppUtil_ScanDevice_t *pDevice);
+static int16_t BLEAppUtil_scanTableFind(const uint8_t *pAddr, uint8_t addrType, uint8_t *pFree);
+static void BLEAppUtil_scanTableRemove(uint8_t index);
+static uint8_t BLEAppUtil_scanTableOldest(uint32_t now);
+static uint32_t BLEAppUtil_scanTableNow(void);
+static uint32_t BLEAppUtil_scanTableMsToTicks(uint32_t ms);
+static void BLEAppUtil_scanTableSummary(uint32_t now, BLEAppUtil_ScanSummary_t *pSummary);
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableInit
+ *
+ * @brief   Enable the scan deduplication table.
+ *
+ * @param   summaryCB     - Called from the BLEAppUtil context with a
+ *                          BLEAppUtil_ScanSummary_t, may be NULL
+ * @param   summaryPeriod - Summary period in ms
+ *
+ * @return  SUCCESS, INVALIDPARAMETER
+ */
+bStatus_t BLEAppUtil_scanTableInit(InvokeFromBLEAppUtilContext_t summaryCB,
+                                   uint32_t summaryPeriod)
+{
+    if (summaryCB != NULL && summaryPeriod == 0)
+    {
+        return INVALIDPARAMETER;
+    }
+
+    // Times are kept in ticks, differences stay right across a wrap
+    scanTableSummaryTicks = BLEAppUtil_scanTableMsToTicks(summaryPeriod);
+    scanTableAgeOutTicks = BLEAppUtil_scanTableMsToTicks(BLEAPPUTIL_SCAN_TABLE_AGE_OUT);
+    scanTableSummaryCB = summaryCB;
+
+    BLEAppUtil_scanTableReset();
+    scanTableEnabled = TRUE;
+
+    return SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_registerScanFilter
+ *
+ * @brief   Register an adv report filter.
+ *
+ * @param   filter - The filter, NULL to remove it
+ *
+ * @return  None
+ */
+void BLEAppUtil_registerScanFilter(BLEAppUtil_ScanFilter_t filter)
+{
+    scanTableFilter = filter;
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableReset
+ *
+ * @brief   Remove all the devices from the scan deduplication table.
+ *
+ * @return  None
+ */
+void BLEAppUtil_scanTableReset(void)
+{
+    ICall_CSState key = ICall_enterCriticalSection();
+
+    memset(scanTable, 0, sizeof(scanTable));
+    memset(&scanTableSummary, 0, sizeof(scanTableSummary));
+    scanTableLastSummary = BLEAppUtil_scanTableNow();
+
+    ICall_leaveCriticalSection(key);
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableGetDevice
+ *
+ * @brief   Get a device entry from the scan deduplication table.
+ *
+ * @param   pAddr    - Device address
+ * @param   addrType - Device address type
+ * @param   pDevice  - Filled with a copy of the table entry
+ *
+ * @return  SUCCESS, FAILURE if the device is not in the table
+ */
+bStatus_t BLEAppUtil_scanTableGetDevice(uint8_t *pAddr, uint8_t addrType,
+                                        BLEAppUtil_ScanDevice_t *pDevice)
+{
+    bStatus_t status = FAILURE;
+    ICall_CSState key;
+    int16_t index;
+
+    if (pAddr == NULL || pDevice == NULL)
+    {
+        return FAILURE;
+    }
+
+    key = ICall_enterCriticalSection();
+    index = BLEAppUtil_scanTableFind(pAddr, addrType, NULL);
+    if (index >= 0)
+    {
+        *pDevice = scanTable[index].device;
+        status = SUCCESS;
+    }
+    ICall_leaveCriticalSection(key);
+
+    return status;
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableUpdate
+ *
+ * @brief   Run the registered filter and update the table with an adv
+ *          report. Called from the scan callback, before the report is
+ *          queued to the BLEAppUtil task.
+ *
+ * @param   pReport - The adv report
+ *
+ * @return  TRUE if the report should be forwarded to the application,
+ *          FALSE if it is a duplicate and can be dropped
+ */
+uint8_t BLEAppUtil_scanTableUpdate(GapScan_Evt_AdvRpt_t *pReport)
+{
+    BLEAppUtil_ScanTableEntry_t *pEntry;
+    ICall_CSState key;
+    uint32_t now;
+    uint32_t dataHash;
+    uint32_t *pHash;
+    int16_t index;
+    uint8_t freeIndex;
+    uint8_t forward = FALSE;
+    uint8_t summaryDue = FALSE;
+    BLEAppUtil_ScanSummary_t summary;
+    BLEAppUtil_ScanFilter_t filter = scanTableFilter;
+
+    if (pReport == NULL)
+    {
+        return TRUE;
+    }
+
+    if (filter != NULL && !filter(pReport))
+    {
+        if (scanTableEnabled)
+        {
+            key = ICall_enterCriticalSection();
+            scanTableSummary.numFiltered++;
+            ICall_leaveCriticalSection(key);
+        }
+        return FALSE;
+    }
+
+    if (!scanTableEnabled)
+    {
+        return TRUE;
+    }
+
+    now = BLEAppUtil_scanTableNow();
+    dataHash = BLEAppUtil_scanTableHash(BLEAPPUTIL_FNV_OFFSET, pReport->pData, pReport->dataLen);
+    if (dataHash == 0)
+    {
+        dataHash = 1;   // 0 marks no data seen yet
+    }
+
+    key = ICall_enterCriticalSection();
+
+    scanTableSummary.numReports++;
+
+    index = BLEAppUtil_scanTableFind(pReport->addr, pReport->addrType, &freeIndex);
+    if (index < 0 && freeIndex >= BLEAPPUTIL_SCAN_TABLE_SIZE)
+    {
+        // The table is full, the device not seen for the longest makes room
+        BLEAppUtil_scanTableRemove(BLEAppUtil_scanTableOldest(now));
+        scanTableSummary.numDevices--;
+        scanTableSummary.numTableFull++;
+        (void)BLEAppUtil_scanTableFind(pReport->addr, pReport->addrType, &freeIndex);
+    }
+
+    if (index >= 0)
+    {
+        pEntry = &scanTable[index];
+
+        // With active scanning adv data and scan responses alternate,
+        // each of them is compared with the last one of its kind
+        pHash = (pReport->evtType & ADV_RPT_EVT_TYPE_SCAN_RSP) ?
+                &pEntry->device.rspHash : &pEntry->device.dataHash;
+        if (*pHash != dataHash)
+        {
+            forward = TRUE;
+        }
+#if BLEAPPUTIL_SCAN_TABLE_RSSI_DELTA > 0
+        else if ((pReport->rssi - pEntry->rssiFwd >= BLEAPPUTIL_SCAN_TABLE_RSSI_DELTA) ||
+                 (pEntry->rssiFwd - pReport->rssi >= BLEAPPUTIL_SCAN_TABLE_RSSI_DELTA))
+        {
+            forward = TRUE;
+        }
+#endif
+
+        if (pEntry->device.count < 0xFFFF)
+        {
+            pEntry->device.count++;
+        }
+    }
+    else
+    {
+        pEntry = &scanTable[freeIndex];
+        memcpy(pEntry->device.addr, pReport->addr, B_ADDR_LEN);
+        pEntry->device.addrType = pReport->addrType;
+        pEntry->device.count = 1;
+        pEntry->device.firstSeen = now;
+        pEntry->device.dataHash = 0;
+        pEntry->device.rspHash = 0;
+        scanTableSummary.numDevices++;
+        scanTableSummary.numNew++;
+        forward = TRUE;
+    }
+
+    pEntry->device.rssi = pReport->rssi;
+    pEntry->device.lastSeen = now;
+    if (pReport->evtType & ADV_RPT_EVT_TYPE_SCAN_RSP)
+    {
+        pEntry->device.rspHash = dataHash;
+    }
+    else
+    {
+        pEntry->device.dataHash = dataHash;
+    }
+    if (forward)
+    {
+        pEntry->rssiFwd = pReport->rssi;
+        scanTableSummary.numForwarded++;
+    }
+
+    if (scanTableSummaryCB != NULL &&
+        (now - scanTableLastSummary) >= scanTableSummaryTicks)
+    {
+        BLEAppUtil_scanTableSummary(now, &summary);
+        summaryDue = TRUE;
+    }
+
+    ICall_leaveCriticalSection(key);
+
+    // Hand the summary over outside of the critical section
+    if (summaryDue)
+    {
+        BLEAppUtil_ScanSummary_t *pSummary = BLEAppUtil_malloc(sizeof(BLEAppUtil_ScanSummary_t));
+
+        if (pSummary != NULL)
+        {
+            *pSummary = summary;
+            if (BLEAppUtil_invokeFunction(scanTableSummaryCB, (char *)pSummary) != SUCCESS)
+            {
+                BLEAppUtil_free(pSummary);
+            }
+        }
+    }
+
+    return forward;
+}
+
+/*********************************************************************
+* LOCAL FUNCTIONS
+*/
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableHash
+ *
+ * @brief   FNV-1a hash
+ *
+ * @param   hash  - Initial hash value
+ * @param   pData - Data to hash
+ * @param   len   - Data length
+ *
+ * @return  The hash
+ */
+static uint32_t BLEAppUtil_scanTableHash(uint32_t hash, const uint8_t *pData, uint16_t len)
+{
+    if (pData != NULL)
+    {
+        while (len--)
+        {
+            hash ^= *pData++;
+            hash *= BLEAPPUTIL_FNV_PRIME;
+        }
+    }
+
+    return hash;
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableHome
+ *
+ * @brief   Get the home slot of a device
+ *
+ * @param   pDevice - The device
+ *
+ * @return  The table index the probe sequence starts from
+ */
+static uint8_t BLEAppUtil_scanTableHome(const BLEAppUtil_ScanDevice_t *pDevice)
+{
+    uint32_t hash = BLEAppUtil_scanTableHash(BLEAPPUTIL_FNV_OFFSET, pDevice->addr, B_ADDR_LEN);
+
+    hash = BLEAppUtil_scanTableHash(hash, &pDevice->addrType, 1);
+
+    return (uint8_t)(hash & BLEAPPUTIL_SCAN_TABLE_MASK);
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableFind
+ *
+ * @brief   Look a device up using linear probing. Must be called with
+ *          interrupts disabled.
+ *
+ * @param   pAddr    - Device address
+ * @param   addrType - Device address type
+ * @param   pFree    - If not NULL, set to the free slot where the device
+ *                     can be added, or BLEAPPUTIL_SCAN_TABLE_SIZE if the
+ *                     table is full
+ *
+ * @return  The table index of the device, -1 if not found
+ */
+static int16_t BLEAppUtil_scanTableFind(const uint8_t *pAddr, uint8_t addrType, uint8_t *pFree)
+{
+    BLEAppUtil_ScanDevice_t key;
+    uint8_t index;
+    uint8_t i;
+
+    memcpy(key.addr, pAddr, B_ADDR_LEN);
+    key.addrType = addrType;
+    index = BLEAppUtil_scanTableHome(&key);
+
+    if (pFree != NULL)
+    {
+        *pFree = BLEAPPUTIL_SCAN_TABLE_SIZE;
+    }
+
+    for (i = 0; i < BLEAPPUTIL_SCAN_TABLE_SIZE; i++)
+    {
+        BLEAppUtil_ScanDevice_t *pDevice = &scanTable[index].device;
+
+        if (pDevice->count == 0)
+        {
+            if (pFree != NULL)
+            {
+                *pFree = index;
+            }
+            break;
+        }
+
+        if (pDevice->addrType == addrType &&
+            memcmp(pDevice->addr, pAddr, B_ADDR_LEN) == 0)
+        {
+            return index;
+        }
+
+        index = (index + 1) & BLEAPPUTIL_SCAN_TABLE_MASK;
+    }
+
+    return -1;
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableRemove
+ *
+ * @brief   Remove an entry and shift back the entries that follow it in
+ *          the same probe sequence, so no tombstones are needed. Must be
+ *          called with interrupts disabled.
+ *
+ * @param   index - The entry to remove
+ *
+ * @return  None
+ */
+static void BLEAppUtil_scanTableRemove(uint8_t index)
+{
+    uint8_t next = index;
+    uint8_t home;
+
+    for (;;)
+    {
+        scanTable[index].device.count = 0;
+
+        for (;;)
+        {
+            next = (next + 1) & BLEAPPUTIL_SCAN_TABLE_MASK;
+            if (scanTable[next].device.count == 0)
+            {
+                return;
+            }
+
+            // Keep the entry in place if its home is cyclically in (index, next]
+            home = BLEAppUtil_scanTableHome(&scanTable[next].device);
+            if ((index <= next) ? ((index < home) && (home <= next)) :
+                                  ((index < home) || (home <= next)))
+            {
+                continue;
+            }
+            break;
+        }
+
+        scanTable[index] = scanTable[next];
+        index = next;
+    }
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableOldest
+ *
+ * @brief   Find the device not seen for the longest time. Must be called
+ *          with interrupts disabled and the table not empty.
+ *
+ * @param   now - Current time in ticks
+ *
+ * @return  The table index of the device
+ */
+static uint8_t BLEAppUtil_scanTableOldest(uint32_t now)
+{
+    uint8_t oldest = 0;
+    uint32_t oldestAge = 0;
+    uint8_t i;
+
+    for (i = 0; i < BLEAPPUTIL_SCAN_TABLE_SIZE; i++)
+    {
+        if (scanTable[i].device.count != 0 &&
+            (now - scanTable[i].device.lastSeen) >= oldestAge)
+        {
+            oldest = i;
+            oldestAge = now - scanTable[i].device.lastSeen;
+        }
+    }
+
+    return oldest;
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableNow
+ *
+ * @brief   Get the current time
+ *
+ * @return  Time in ICall ticks
+ */
+static uint32_t BLEAppUtil_scanTableNow(void)
+{
+    return ICall_getTicks();
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableMsToTicks
+ *
+ * @brief   Convert an interval to ICall ticks, rounded up
+ *
+ * @param   ms - Interval in ms
+ *
+ * @return  Interval in ticks
+ */
+static uint32_t BLEAppUtil_scanTableMsToTicks(uint32_t ms)
+{
+    // Tick period is in us
+    uint32_t tickPeriod = ICall_getTickPeriod();
+
+    if (tickPeriod == 0)
+    {
+        tickPeriod = 1;
+    }
+
+    return (uint32_t)(((uint64_t)ms * 1000 + tickPeriod - 1) / tickPeriod);
+}
+
+/*********************************************************************
+ * @fn      BLEAppUtil_scanTableSummary
+ *
+ * @brief   Age out old devices and take the summary of the period.
+ *          Must be called with interrupts disabled.
+ *
+ * @param   now      - Current time in ticks
+ * @param   pSummary - Filled with the summary
+ *
+ * @return  None
+ */
+static void BLEAppUtil_scanTableSummary(uint32_t now, BLEAppUtil_ScanSummary_t *pSummary)
+{
+    uint8_t i = 0;
+
+    while (i < BLEAPPUTIL_SCAN_TABLE_SIZE)
+    {
+        // A removal may shift another entry into this slot, check it again
+        if (scanTable[i].device.count != 0 &&
+            (now - scanTable[i].device.lastSeen) >= scanTableAgeOutTicks)
+        {
+            BLEAppUtil_scanTableRemove(i);
+            scanTableSummary.numDevices--;
+            scanTableSummary.numAged++;
+            continue;
+        }
+        i++;
+    }
+
+    *pSummary = scanTableSummary;
+
+    // Keep the device count, clear the per-period counters
+    scanTableSummary.numNew = 0;
+    scanTableSummary.numAged = 0;
+    scanTableSummary.numReports = 0;
+    scanTableSummary.numFiltered = 0;
+    scanTableSummary.numForwarded = 0;
+    scanTableSummary.numTableFull = 0;
+    scanTableLastSummary = now;
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -22,12 +22,18 @@ $Release Date: PACKAGE RELEASE DATE $
 #include <stdarg.h>
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
 #include <ti/bleapp/ble_app_util/inc/bleapputil_internal.h>
+#include <common/BLEAppUtil/inc/bleapputil_heap.h>
+#include <common/BLEAppUtil/inc/bleapputil_local.h>
 
 /*********************************************************************
  * MACROS
  */
 #define BLEAPPUTIL_PAIR_STATE_TABLE_SIZE 7
 
+#if defined(BLEAPPUTIL_DIRECT_STACK_DISPATCH) && !defined(ICALL_NO_APP_EVENTS)
+#error "BLEAPPUTIL_DIRECT_STACK_DISPATCH requires ICALL_NO_APP_EVENTS"
+#endif
+
 /*********************************************************************
 * CONSTANTS
 */
@@ -64,6 +70,16 @@ const uint8_t pairStateLookupTable[BLEAPPUTIL_PAIR_STATE_TABLE_SIZE] =
  * @fn      BLEAppUtil_processStackMsgCB
  *
  * @brief   BLE stack callback
+ *          By default the msg is enqueued and processed in the BLEAppUtil
+ *          task. With BLEAPPUTIL_DIRECT_STACK_DISPATCH (requires
+ *          ICALL_NO_APP_EVENTS) it is processed right here, in the stack
+ *          context, saving one queue and one context switch per event.
+ *          Only GAP_DEVICE_INIT_DONE_EVENT is still enqueued, its handler
+ *          starts the application.
+ *          Note: In direct mode the registered event handlers run in the
+ *                stack context, so they must not block and must not call
+ *                BLE stack APIs directly. Use @ref BLEAppUtil_invokeFunction
+ *                to defer such work to the BLEAppUtil task.
  *
  * @param   event    - todo - remove the event from BLEAppUtil_processStackMsgCB
  * @param   pMessage - message from ble stack
@@ -72,11 +88,27 @@ const uint8_t pairStateLookupTable[BLEAPPUTIL_PAIR_STATE_TABLE_SIZE] =
  */
 uint8_t BLEAppUtil_processStackMsgCB(uint8_t event, uint8_t *pMessage)
 {
+#ifdef BLEAPPUTIL_DIRECT_STACK_DISPATCH
+  BLEAppUtil_msgHdr_t *pMsgData = (BLEAppUtil_msgHdr_t *)pMessage;
+
+  // ignore the event
+  // Process the msg right away, without going through the BLEAppUtil queue
+  if (pMsgData->event != GAP_MSG_EVENT ||
+      ((gapEventHdr_t *)pMsgData)->opcode != GAP_DEVICE_INIT_DONE_EVENT)
+  {
+      BLEAppUtil_processStackMsg(pMsgData);
+
+      // Safe to dealloc, the msg is not used after this call
+      return TRUE;
+  }
+#endif // BLEAPPUTIL_DIRECT_STACK_DISPATCH
+
   // ignore the event
   // Enqueue the msg in order to be excuted in the application context
   if (BLEAppUtil_enqueueMsg(BLEAPPUTIL_EVT_STACK_CALLBACK, pMessage) != SUCCESS)
   {
-      BLEAppUtil_free(pMessage);
+      // The msg was allocated by the stack with an ICall msg header
+      BLEAppUtil_freeMsg(pMessage);
   }
 
   // Not safe to dealloc, the application BleAppUtil module will free the msg
@@ -187,7 +219,26 @@ void BLEAppUtil_connEventCB(Gap_ConnEventRpt_t *pReport)
  */
 void BLEAppUtil_scanCB(uint32_t event, GapScan_data_t *pBuf, uint32_t *arg)
 {
-    BLEAppUtil_ScanEventData_t *pData = BLEAppUtil_malloc(sizeof(BLEAppUtil_ScanEventData_t));
+    BLEAppUtil_ScanEventData_t *pData;
+
+    if (event == BLEAPPUTIL_SCAN_ENABLED)
+    {
+        // Every scan starts with an empty deduplication table
+        BLEAppUtil_scanTableReset();
+    }
+    else if (event == BLEAPPUTIL_ADV_REPORT && pBuf != NULL &&
+             !BLEAppUtil_scanTableUpdate(&pBuf->pAdvReport))
+    {
+        // Filtered out or duplicate report, drop it before it is queued
+        if (pBuf->pAdvReport.pData)
+        {
+            BLEAppUtil_free(pBuf->pAdvReport.pData);
+        }
+        BLEAppUtil_free(pBuf);
+        return;
+    }
+
+    pData = BLEAppUtil_malloc(sizeof(BLEAppUtil_ScanEventData_t));
 
     if (pData)
     {
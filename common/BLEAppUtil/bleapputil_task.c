@@ -21,6 +21,7 @@ $Release Date: PACKAGE RELEASE DATE $
  */
 #include <common/BLEAppUtil/inc/bleapputil_api.h>
 #include <ti/bleapp/ble_app_util/inc/bleapputil_internal.h>
+#include <common/BLEAppUtil/inc/bleapputil_local.h>
 #include <app_main.h>
 
 /*********************************************************************
@@ -132,6 +133,75 @@ status_t BLEAppUtil_enqueueMsg(uint8_t event, void *pData)
     return status;
 }
 
+/*********************************************************************
+ * @fn      BLEAppUtil_processStackMsg
+ *
+ * @brief   Dispatch a message received from the BLE stack to the
+ *          matching BLEAppUtil process function. Called from the
+ *          BLEAppUtil task, or from the stack callback with
+ *          BLEAPPUTIL_DIRECT_STACK_DISPATCH.
+ *          Note: The msg itself is not freed by this function.
+ *
+ * @param   pMsgData - message from ble stack
+ *
+ * @return  None
+ */
+void BLEAppUtil_processStackMsg(BLEAppUtil_msgHdr_t *pMsgData)
+{
+    switch (pMsgData->event)
+    {
+        case GAP_MSG_EVENT:
+            BLEAppUtil_processGAPEvents(pMsgData);
+            break;
+
+        case GATT_MSG_EVENT:
+            BLEAppUtil_processGATTEvents(pMsgData);
+            break;
+
+        case L2CAP_DATA_EVENT:
+            BLEAppUtil_processL2CAPDataMsg(pMsgData);
+            break;
+
+        case L2CAP_SIGNAL_EVENT:
+            BLEAppUtil_processL2CAPSignalEvents(pMsgData);
+            break;
+
+        case HCI_GAP_EVENT_EVENT:
+            BLEAppUtil_processHCIGAPEvents(pMsgData);
+            break;
+
+        case HCI_DATA_EVENT:
+            BLEAppUtil_processHCIDataEvents(pMsgData);
+            break;
+
+        case HCI_SMP_EVENT_EVENT:
+            BLEAppUtil_processHCISMPEvents(pMsgData);
+            break;
+
+        case HCI_SMP_META_EVENT_EVENT:
+            BLEAppUtil_processHCISMPMetaEvents(pMsgData);
+            break;
+
+        case HCI_CTRL_TO_HOST_EVENT:
+        {
+            BLEAppUtil_processHCICTRLToHostEvents(pMsgData);
+            hciPacket_t *pBuf = (hciPacket_t *)pMsgData;
+            switch (pBuf->pData[0])
+            {
+              case HCI_ACL_DATA_PACKET:
+              case HCI_SCO_DATA_PACKET:
+                BM_free(pBuf->pData);
+              default:
+                break;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
 /*********************************************************************
  * @fn      BLEAppUtil_Task
  *
@@ -172,61 +242,10 @@ void *BLEAppUtil_Task(void *arg)
                   // should be used to free the msg
                   freeMsg = TRUE;
 
-                  switch (pMsgData->event)
-                  {
-                      case GAP_MSG_EVENT:
-                          BLEAppUtil_processGAPEvents(pMsgData);
-                          break;
-
-                      case GATT_MSG_EVENT:
-                          BLEAppUtil_processGATTEvents(pMsgData);
-                          break;
-
-                      case L2CAP_DATA_EVENT:
-                          BLEAppUtil_processL2CAPDataMsg(pMsgData);
-                          break;
-
-                      case L2CAP_SIGNAL_EVENT:
-                          BLEAppUtil_processL2CAPSignalEvents(pMsgData);
-                          break;
-
-                      case HCI_GAP_EVENT_EVENT:
-                          BLEAppUtil_processHCIGAPEvents(pMsgData);
-                          break;
-
-                      case HCI_DATA_EVENT:
-                          BLEAppUtil_processHCIDataEvents(pMsgData);
-                          break;
-
-                      case HCI_SMP_EVENT_EVENT:
-                          BLEAppUtil_processHCISMPEvents(pMsgData);
-                          break;
-
-                      case HCI_SMP_META_EVENT_EVENT:
-                          BLEAppUtil_processHCISMPMetaEvents(pMsgData);
-                          break;
-
-                    case HCI_CTRL_TO_HOST_EVENT:
-                    {
-                        BLEAppUtil_processHCICTRLToHostEvents(pMsgData);
-                        hciPacket_t *pBuf = (hciPacket_t *)pMsgData;
-                        switch (pBuf->pData[0])
-                        {
-                          case HCI_ACL_DATA_PACKET:
-                          case HCI_SCO_DATA_PACKET:
-                            BM_free(pBuf->pData);
-                          default:
-                            break;
-                        }
-                        break;
-                    }
-
-
-                    default:
-                        break;
-                }
-                break;
-            }
+                  BLEAppUtil_processStackMsg(pMsgData);
+                  break;
+              }
+
               case BLEAPPUTIL_EVT_ADV_CB_EVENT:
               {
                   BLEAppUtil_processAdvEventMsg(pMsgData);
@@ -108,6 +108,17 @@ typedef void (*StackInitDone_t)(gapDeviceInitDoneEvent_t *deviceInitDoneData);
  */
 typedef void (*InvokeFromBLEAppUtilContext_t)(char *pData);
 
+/**
+ * @brief   Adv report filter, see @ref BLEAppUtil_registerScanFilter.
+ *          Called from the stack context for every adv report, so it
+ *          shall be short and shall not call BLE stack APIs.
+ *
+ * @param pReport - The adv report
+ *
+ * @return  TRUE to keep the report, FALSE to drop it
+ */
+typedef uint8_t (*BLEAppUtil_ScanFilter_t)(GapScan_Evt_AdvRpt_t *pReport);
+
 /** @} End BLEAppUtil_Functions_Typedefs */
 
 /*********************************************************************
@@ -335,6 +346,42 @@ typedef struct
     uint32_t        *arg;  //!< custom application argument that can be return through this callback
 } BLEAppUtil_ScanEventData_t;
 
+/**
+ * @brief BLEAppUtil Scan Table Device Structure
+ *
+ * One entry of the scan deduplication table, see
+ * @ref BLEAppUtil_scanTableInit
+ */
+typedef struct
+{
+    BLEAppUtil_BDaddr   addr;       //!< Device address
+    uint8_t             addrType;   //!< Device address type
+    int8_t              rssi;       //!< RSSI of the latest adv report
+    uint16_t            count;      //!< Number of adv reports received
+    uint32_t            firstSeen;  //!< Time of the first adv report (ICall ticks)
+    uint32_t            lastSeen;   //!< Time of the latest adv report (ICall ticks)
+    uint32_t            dataHash;   //!< Hash of the latest adv data, 0: none yet
+    uint32_t            rspHash;    //!< Hash of the latest scan response data, 0: none yet
+} BLEAppUtil_ScanDevice_t;
+
+/**
+ * @brief BLEAppUtil Scan Table Summary Structure
+ *
+ * Provided to the summary callback registered with
+ * @ref BLEAppUtil_scanTableInit. The counters cover the time since
+ * the previous summary.
+ */
+typedef struct
+{
+    uint16_t    numDevices;     //!< Devices currently in the table
+    uint16_t    numNew;         //!< Devices added to the table
+    uint16_t    numAged;        //!< Devices removed after not being seen
+    uint32_t    numReports;     //!< Adv reports received from the stack
+    uint32_t    numFiltered;    //!< Adv reports dropped by the scan filter
+    uint32_t    numForwarded;   //!< Adv reports forwarded to the application
+    uint32_t    numTableFull;   //!< Devices evicted, least recently seen first, because the table was full
+} BLEAppUtil_ScanSummary_t;
+
 /**
  * @brief BLEAppUtil PairState Event Data Structure
  */
@@ -595,6 +642,9 @@ typedef struct
  *
  * This must be setup by the application and passed to the BLEAppUtil module
  * by calling @ref BLEAppUtil_registerEventHandler.
+ * With BLEAPPUTIL_DIRECT_STACK_DISPATCH the handlers of the stack message
+ * types (GAP, GATT, L2CAP and HCI) run in the stack context. They must not
+ * block and must defer BLE stack API calls with @ref BLEAppUtil_invokeFunction.
  */
 typedef struct
 {
@@ -787,6 +837,55 @@ bStatus_t BLEAppUtil_scanStart(const BLEAppUtil_ScanStart_t *scanStartInfo);
  */
 bStatus_t BLEAppUtil_scanStop(void);
 
+/**
+ * @brief   Enable the scan deduplication table.
+ *          Once enabled, adv reports are checked against the table in the
+ *          stack callback, and only reports from new devices or with
+ *          changed adv data are forwarded as @ref BLEAPPUTIL_ADV_REPORT.
+ *          The table is cleared every time scanning is enabled.
+ *
+ * @param   summaryCB     - Called from the BLEAppUtil context with a
+ *                          @ref BLEAppUtil_ScanSummary_t every
+ *                          summaryPeriod ms while reports are received.
+ *                          May be NULL.
+ * @param   summaryPeriod - Summary period in ms
+ *
+ * @return  SUCCESS, INVALIDPARAMETER
+ */
+bStatus_t BLEAppUtil_scanTableInit(InvokeFromBLEAppUtilContext_t summaryCB,
+                                   uint32_t summaryPeriod);
+
+/**
+ * @brief   Register an adv report filter.
+ *          The filter runs in the stack callback, before the report is
+ *          checked against the scan table and before anything is
+ *          allocated or queued for the application.
+ *
+ * @param   filter - The filter, NULL to remove it
+ *
+ * @return  None
+ */
+void BLEAppUtil_registerScanFilter(BLEAppUtil_ScanFilter_t filter);
+
+/**
+ * @brief   Remove all the devices from the scan deduplication table.
+ *
+ * @return  None
+ */
+void BLEAppUtil_scanTableReset(void);
+
+/**
+ * @brief   Get a device entry from the scan deduplication table.
+ *
+ * @param   pAddr    - Device address
+ * @param   addrType - Device address type
+ * @param   pDevice  - Filled with a copy of the table entry
+ *
+ * @return  SUCCESS, FAILURE if the device is not in the table
+ */
+bStatus_t BLEAppUtil_scanTableGetDevice(uint8_t *pAddr, uint8_t addrType,
+                                        BLEAppUtil_ScanDevice_t *pDevice);
+
 // Connection initiation functions
 
 /**
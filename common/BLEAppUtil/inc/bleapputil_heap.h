@@ -0,0 +1,40 @@
+/******************************************************************************
+
+@file  bleapputil_heap.h
+
+@brief This file accounts the BLEAppUtil allocations to their own heap tag
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+/**
+ *  @file  bleapputil_heap.h
+ *  @brief Include after bleapputil_internal.h, which defines
+ *  BLEAppUtil_malloc, in the BLEAppUtil files which allocate.
+ *  With ICALL_HEAP_TAGGING the blocks are then reported under
+ *  ICALL_HEAP_TAG_BLEAPPUTIL, see @ref ICall_getHeapTagStats.
+ */
+
+#ifndef BLEAPPUTIL_HEAP_H
+#define BLEAPPUTIL_HEAP_H
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <ti/bleapp/ble_app_util/inc/bleapputil_internal.h>
+
+/*********************************************************************
+ * MACROS
+ */
+#ifdef ICALL_HEAP_TAGGING
+#undef BLEAppUtil_malloc
+#define BLEAppUtil_malloc(size) ICall_mallocTag((size), ICALL_HEAP_TAG_BLEAPPUTIL)
+#endif
+
+#endif /* BLEAPPUTIL_HEAP_H */
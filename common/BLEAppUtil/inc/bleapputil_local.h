@@ -0,0 +1,51 @@
+/******************************************************************************
+
+@file  bleapputil_local.h
+
+@brief This file contains the functions shared between the BLEAppUtil files,
+       not used by the application
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+#ifndef BLEAPPUTIL_LOCAL_H
+#define BLEAPPUTIL_LOCAL_H
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <common/BLEAppUtil/inc/bleapputil_api.h>
+#include <ti/bleapp/ble_app_util/inc/bleapputil_internal.h>
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/**
+ * @brief   Dispatch a message received from the BLE stack to the matching
+ *          BLEAppUtil process function. The msg itself is not freed.
+ *
+ * @param   pMsgData - message from ble stack
+ *
+ * @return  None
+ */
+void BLEAppUtil_processStackMsg(BLEAppUtil_msgHdr_t *pMsgData);
+
+/**
+ * @brief   Run the registered scan filter and update the scan table with
+ *          an adv report, see bleapputil_scan_table.c
+ *
+ * @param   pReport - The adv report
+ *
+ * @return  TRUE if the report should be forwarded to the application
+ */
+uint8_t BLEAppUtil_scanTableUpdate(GapScan_Evt_AdvRpt_t *pReport);
+
+#endif /* BLEAPPUTIL_LOCAL_H */
@@ -57,6 +57,15 @@ extern "C" {
 #define CRC_ALGO_TABLE_DRIVEN 1
 
 
+/**
+ * Bytes handled per loop in crc_update(): 4 uses three more 256 byte tables
+ * (slice-by-4), 1 the single table only. Both give the same crc.
+ */
+#ifndef CRC_SLICES
+#define CRC_SLICES 4
+#endif
+
+
 /**
  * The type of the CRC values.
  *
@@ -80,7 +89,8 @@ static inline crc_t crc_init(void)
  * Update the crc value with new data.
  *
  * \param[in] crc      The current crc value.
- * \param[in] data     Pointer to a buffer of \a data_len bytes.
+ * \param[in] data     Pointer to a buffer of \a data_len bytes, e.g. memory
+ *                     mapped flash, any alignment.
  * \param[in] data_len Number of bytes in the \a data buffer.
  * \return             The updated crc value.
  */
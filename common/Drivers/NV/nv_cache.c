@@ -0,0 +1,424 @@
+/******************************************************************************
+
+@file  nv_cache.c
+
+@brief Write-back cache for often rewritten NV items, above the NVINTF API.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * nvCache_loadApiPtrs() fills a NVINTF_nvFuncts_t which calls the driver
+ * table given (normally nvintfFncStruct), so a caller switches by using the
+ * other table. Only items added with nvCache_addItem() are held in RAM, all
+ * other items, and cached items longer than NV_CACHE_ITEM_LEN, go straight
+ * to the driver.
+ *
+ * A write of a cached item only updates the RAM copy. It goes to flash when:
+ *   - NV_CACHE_FLUSH_WRITES writes were held for it,
+ *   - it has been dirty for NV_CACHE_FLUSH_TICKS calls of nvCache_tick(),
+ *   - nvCache_flush() is called, e.g. by a writer which needs the item in
+ *     flash, or before a reset,
+ *   - any other operation needs flash to be up to date (readContItem,
+ *     compactNV, doNext).
+ * Writes of unchanged content are dropped. Dirty data is lost on a power
+ * cut, so bonds and other items which must survive one are not cached.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "nv_cache.h"
+
+typedef struct
+{
+    NVINTF_itemID_t id;
+    uint8_t  used;          // added with nvCache_addItem()
+    uint8_t  loaded;        // data/len hold the item (len 0: not in NV)
+    uint8_t  dirty;         // RAM copy newer than flash
+    uint8_t  heldWrites;
+    uint16_t dirtyTicks;
+    uint16_t len;
+    uint8_t  data[NV_CACHE_ITEM_LEN];
+} nvCache_slot_t;
+
+/* === Local Variables ===*/
+static NVINTF_nvFuncts_t nvLower;
+static nvCache_slot_t nvCacheSlots[NV_CACHE_SLOTS];
+static nvCache_stats_t nvCacheStats;
+static pthread_mutex_t nvCacheMutex;
+static uint8_t nvCacheReady = false;
+
+static nvCache_slot_t *nvCache_findSlot(NVINTF_itemID_t id)
+{
+    uint8_t i;
+
+    for (i = 0; i < NV_CACHE_SLOTS; i++)
+    {
+        if (nvCacheSlots[i].used &&
+            nvCacheSlots[i].id.systemID == id.systemID &&
+            nvCacheSlots[i].id.itemID == id.itemID &&
+            nvCacheSlots[i].id.subID == id.subID)
+        { return &nvCacheSlots[i]; }
+    }
+    return NULL;
+}
+
+/* Read the item from the driver into the slot, unless it is there already */
+static uint8_t nvCache_loadSlot(nvCache_slot_t *pSlot)
+{
+    uint32_t len;
+
+    if (pSlot->loaded)
+    { return NVINTF_SUCCESS; }
+
+    len = nvLower.getItemLen(pSlot->id);
+    if (len > NV_CACHE_ITEM_LEN)
+    { return NVINTF_BADLENGTH; }   // too long, not held
+
+    if (len > 0 && nvLower.readItem(pSlot->id, 0, len, pSlot->data) != NVINTF_SUCCESS)
+    { return NVINTF_FAILURE; }
+
+    pSlot->len = len;
+    pSlot->loaded = true;
+    return NVINTF_SUCCESS;
+}
+
+static uint8_t nvCache_flushSlot(nvCache_slot_t *pSlot)
+{
+    uint8_t status;
+
+    if (!pSlot->dirty)
+    { return NVINTF_SUCCESS; }
+
+    status = nvLower.writeItem(pSlot->id, pSlot->len, pSlot->data);
+    nvCacheStats.flashWrites++;
+    if (status == NVINTF_SUCCESS)
+    {
+        pSlot->dirty = false;
+        pSlot->heldWrites = 0;
+        pSlot->dirtyTicks = 0;
+    }
+    return status;
+}
+
+static uint8_t nvCache_flushAll(void)
+{
+    uint8_t status = NVINTF_SUCCESS;
+    uint8_t i;
+
+    for (i = 0; i < NV_CACHE_SLOTS; i++)
+    {
+        if (nvCacheSlots[i].used && nvCache_flushSlot(&nvCacheSlots[i]) != NVINTF_SUCCESS)
+        { status = NVINTF_FAILURE; }
+    }
+    return status;
+}
+
+/* Written or deleted around the cache, read it again when needed */
+static void nvCache_dropSlot(nvCache_slot_t *pSlot)
+{
+    pSlot->loaded = false;
+    pSlot->dirty = false;
+    pSlot->heldWrites = 0;
+    pSlot->dirtyTicks = 0;
+}
+
+static uint8_t nvCache_readItem(NVINTF_itemID_t id, uint16_t offset, uint16_t length, void *buffer)
+{
+    nvCache_slot_t *pSlot;
+    uint8_t status;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    pSlot = nvCache_findSlot(id);
+    if (pSlot == NULL || nvCache_loadSlot(pSlot) != NVINTF_SUCCESS)
+    {
+        pthread_mutex_unlock(&nvCacheMutex);
+        return nvLower.readItem(id, offset, length, buffer);
+    }
+
+    if (pSlot->len == 0)
+    { status = NVINTF_NOTFOUND; }
+    else if (length > pSlot->len)
+    { status = NVINTF_BADLENGTH; }
+    else if (offset + length > pSlot->len)
+    { status = NVINTF_BADOFFSET; }
+    else
+    {
+        memcpy(buffer, &pSlot->data[offset], length);
+        status = NVINTF_SUCCESS;
+    }
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint32_t nvCache_getItemLen(NVINTF_itemID_t id)
+{
+    nvCache_slot_t *pSlot;
+    uint32_t len;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    pSlot = nvCache_findSlot(id);
+    if (pSlot == NULL || nvCache_loadSlot(pSlot) != NVINTF_SUCCESS)
+    {
+        pthread_mutex_unlock(&nvCacheMutex);
+        return nvLower.getItemLen(id);
+    }
+    len = pSlot->len;
+    pthread_mutex_unlock(&nvCacheMutex);
+    return len;
+}
+
+static uint8_t nvCache_writeItem(NVINTF_itemID_t id, uint16_t length, void *buffer)
+{
+    nvCache_slot_t *pSlot;
+    uint8_t status = NVINTF_SUCCESS;
+
+    if (buffer == NULL || length == 0)
+    { return NVINTF_BADPARAM; }
+
+    pthread_mutex_lock(&nvCacheMutex);
+    pSlot = nvCache_findSlot(id);
+    if (pSlot == NULL || length > NV_CACHE_ITEM_LEN)
+    {
+        if (pSlot != NULL)
+        { nvCache_dropSlot(pSlot); }
+        pthread_mutex_unlock(&nvCacheMutex);
+        return nvLower.writeItem(id, length, buffer);
+    }
+
+    nvCacheStats.writes++;
+    (void)nvCache_loadSlot(pSlot);  // only to spot unchanged writes
+
+    if (pSlot->loaded && pSlot->len == length && memcmp(pSlot->data, buffer, length) == 0)
+    { nvCacheStats.unchanged++; }
+    else
+    {
+        memcpy(pSlot->data, buffer, length);
+        pSlot->len = length;
+        pSlot->loaded = true;
+        pSlot->dirty = true;
+        if (++pSlot->heldWrites >= NV_CACHE_FLUSH_WRITES)
+        { status = nvCache_flushSlot(pSlot); }
+    }
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint8_t nvCache_createItem(NVINTF_itemID_t id, uint32_t length, void *buffer)
+{
+    nvCache_slot_t *pSlot;
+    uint8_t status;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    pSlot = nvCache_findSlot(id);
+    if (pSlot != NULL)
+    {
+        (void)nvCache_flushSlot(pSlot);
+        nvCache_dropSlot(pSlot);
+    }
+    status = nvLower.createItem(id, length, buffer);
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint8_t nvCache_updateItem(NVINTF_itemID_t id, uint32_t length, void *buffer)
+{
+    nvCache_slot_t *pSlot;
+    uint8_t status;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    pSlot = nvCache_findSlot(id);
+    if (pSlot != NULL)
+    {
+        (void)nvCache_flushSlot(pSlot);
+        nvCache_dropSlot(pSlot);
+    }
+    status = nvLower.updateItem(id, length, buffer);
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint8_t nvCache_deleteItem(NVINTF_itemID_t id)
+{
+    nvCache_slot_t *pSlot;
+    uint8_t wasDirty = false;
+    uint8_t status;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    pSlot = nvCache_findSlot(id);
+    if (pSlot != NULL)
+    {
+        // Held writes are dropped, they would only be deleted again
+        wasDirty = pSlot->dirty;
+        nvCache_dropSlot(pSlot);
+    }
+    status = nvLower.deleteItem(id);
+    if (wasDirty && status == NVINTF_NOTFOUND)
+    { status = NVINTF_SUCCESS; }    // only ever written to the cache
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint8_t nvCache_readContItem(NVINTF_itemID_t id, uint16_t offset, uint16_t rlength, void *rbuffer,
+                                    uint16_t clength, uint16_t coffset, void *cbuffer, uint16_t *pSubId)
+{
+    uint8_t status;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    (void)nvCache_flushAll();
+    status = nvLower.readContItem(id, offset, rlength, rbuffer, clength, coffset, cbuffer, pSubId);
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint8_t nvCache_compactNV(uint16_t minBytes)
+{
+    uint8_t status;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    (void)nvCache_flushAll();
+    status = nvLower.compactNV(minBytes);
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint8_t nvCache_doNext(NVINTF_nvProxy_t *nvProxy)
+{
+    uint8_t status;
+    uint8_t i;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    (void)nvCache_flushAll();
+    status = nvLower.doNext(nvProxy);
+    if (nvProxy->flag & NVINTF_DODELETE)
+    {
+        for (i = 0; i < NV_CACHE_SLOTS; i++)
+        { nvCache_dropSlot(&nvCacheSlots[i]); }
+    }
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+static uint8_t nvCache_eraseNV(void)
+{
+    uint8_t status;
+    uint8_t i;
+
+    pthread_mutex_lock(&nvCacheMutex);
+    for (i = 0; i < NV_CACHE_SLOTS; i++)
+    { nvCache_dropSlot(&nvCacheSlots[i]); }
+    status = nvLower.eraseNV();
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+/*
+ * Fill pfn with the cache functions on top of pLower. Functions which are
+ * NULL in pLower stay NULL.
+ */
+void nvCache_loadApiPtrs(NVINTF_nvFuncts_t *pfn, const NVINTF_nvFuncts_t *pLower)
+{
+    if (!nvCacheReady)
+    {
+        if (pthread_mutex_init(&nvCacheMutex, NULL) != 0)
+        { while (1) {} /* Error creating mutex */ }
+        nvCacheReady = true;
+    }
+
+    nvLower = *pLower;
+    *pfn = *pLower;
+
+    if (pLower->readItem != NULL && pLower->getItemLen != NULL && pLower->writeItem != NULL)
+    {
+        pfn->readItem   = nvCache_readItem;
+        pfn->getItemLen = nvCache_getItemLen;
+        pfn->writeItem  = nvCache_writeItem;
+    }
+    if (pLower->createItem != NULL)
+    { pfn->createItem = nvCache_createItem; }
+    if (pLower->updateItem != NULL)
+    { pfn->updateItem = nvCache_updateItem; }
+    if (pLower->deleteItem != NULL)
+    { pfn->deleteItem = nvCache_deleteItem; }
+    if (pLower->readContItem != NULL)
+    { pfn->readContItem = nvCache_readContItem; }
+    if (pLower->compactNV != NULL)
+    { pfn->compactNV = nvCache_compactNV; }
+    if (pLower->doNext != NULL)
+    { pfn->doNext = nvCache_doNext; }
+    if (pLower->eraseNV != NULL)
+    { pfn->eraseNV = nvCache_eraseNV; }
+}
+
+/* Hold writes of this item in RAM. Returns NVINTF_FAILURE when all slots are used. */
+uint8_t nvCache_addItem(NVINTF_itemID_t id)
+{
+    uint8_t i;
+
+    if (!nvCacheReady)
+    { return NVINTF_NOTREADY; }
+
+    pthread_mutex_lock(&nvCacheMutex);
+    if (nvCache_findSlot(id) != NULL)
+    {
+        pthread_mutex_unlock(&nvCacheMutex);
+        return NVINTF_SUCCESS;
+    }
+    for (i = 0; i < NV_CACHE_SLOTS; i++)
+    {
+        if (!nvCacheSlots[i].used)
+        {
+            memset(&nvCacheSlots[i], 0x00, sizeof(nvCache_slot_t));
+            nvCacheSlots[i].id = id;
+            nvCacheSlots[i].used = true;
+            pthread_mutex_unlock(&nvCacheMutex);
+            return NVINTF_SUCCESS;
+        }
+    }
+    pthread_mutex_unlock(&nvCacheMutex);
+    return NVINTF_FAILURE;
+}
+
+/* Write every dirty item now */
+uint8_t nvCache_flush(void)
+{
+    uint8_t status;
+
+    if (!nvCacheReady)
+    { return NVINTF_SUCCESS; }
+
+    pthread_mutex_lock(&nvCacheMutex);
+    status = nvCache_flushAll();
+    pthread_mutex_unlock(&nvCacheMutex);
+    return status;
+}
+
+/* Call periodically, flushes items which have been dirty too long */
+void nvCache_tick(void)
+{
+    uint8_t i;
+
+    if (!nvCacheReady)
+    { return; }
+
+    pthread_mutex_lock(&nvCacheMutex);
+    for (i = 0; i < NV_CACHE_SLOTS; i++)
+    {
+        if (nvCacheSlots[i].used && nvCacheSlots[i].dirty &&
+            ++nvCacheSlots[i].dirtyTicks >= NV_CACHE_FLUSH_TICKS)
+        { (void)nvCache_flushSlot(&nvCacheSlots[i]); }
+    }
+    pthread_mutex_unlock(&nvCacheMutex);
+}
+
+void nvCache_getStats(nvCache_stats_t *pStats)
+{
+    *pStats = nvCacheStats;
+}
@@ -0,0 +1,40 @@
+/******************************************************************************
+
+@file  nv_cache.h
+
+@brief Write-back cache for often rewritten NV items, see nv_cache.c
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+#ifndef COMMON_DRIVERS_NV_NV_CACHE_H_
+#define COMMON_DRIVERS_NV_NV_CACHE_H_
+
+#include "nvintf.h"
+
+#define NV_CACHE_SLOTS          4       // items which can be held in RAM
+#define NV_CACHE_ITEM_LEN       32      // longer items are written through
+#define NV_CACHE_FLUSH_WRITES   16      // flush an item after this many held writes
+#define NV_CACHE_FLUSH_TICKS    10      // or once it has been dirty this many nvCache_tick()
+
+typedef struct
+{
+    uint32_t writes;        // writes of cached items
+    uint32_t unchanged;     // writes dropped, same content as held
+    uint32_t flashWrites;   // writes handed to the driver, saved = writes - flashWrites
+} nvCache_stats_t;
+
+void nvCache_loadApiPtrs(NVINTF_nvFuncts_t *pfn, const NVINTF_nvFuncts_t *pLower);
+uint8_t nvCache_addItem(NVINTF_itemID_t id);
+uint8_t nvCache_flush(void);
+void nvCache_tick(void);
+void nvCache_getStats(nvCache_stats_t *pStats);
+
+#endif /* COMMON_DRIVERS_NV_NV_CACHE_H_ */
@@ -0,0 +1,361 @@
+/******************************************************************************
+
+@file  nv_log.c
+
+@brief Append-only record log in its own NVS region (CONFIG_NVSLOG).
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * Events which should survive a reset (asserts, link drops, throughput
+ * samples) are appended here instead of being NVOCMP items, which would
+ * each be a new item and bring compactions forward.
+ *
+ * The region is used as a ring of flash pages. Each page starts with
+ * {NV_LOG_MAGIC, seq of its first record}, then records follow back to back,
+ * 4 byte aligned: nvLog_hdr_t and the data. An append is one NVS write at
+ * the write pointer; when the record does not fit, the oldest page is erased
+ * and becomes the new page, so the log keeps the last (pages - 1) to pages
+ * worth of records.
+ *
+ * At init the page with the highest seq is the newest, its records are
+ * walked to the first free header to find the write pointer. A record cut by
+ * a power loss fails its CRC (or leaves a header which is not erased), the
+ * rest of that page is not written and the log goes on in the next page.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <ti/drivers/NVS.h>
+#include <ti/drivers/dpl/ClockP.h>
+#include "ti_drivers_config.h"
+#include "crc.h"
+#include "nv_log.h"
+
+#ifndef NV_LOG_NVS_INDEX
+#define NV_LOG_NVS_INDEX        CONFIG_NVSLOG
+#endif
+
+#define NV_LOG_MAGIC            0x474F4C4E      // "NLOG"
+#define NV_LOG_FREE_LEN         0xFFFF
+#define NV_LOG_ALIGN(n)         (((n) + 3) & ~3UL)
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;       // seq of the first record of the page
+} nvLog_pageHdr_t;
+
+/* === Local Variables ===*/
+static NVS_Handle nvLogHandle = NULL;
+static NVS_Attrs nvLogAttrs;
+static pthread_mutex_t nvLogMutex;
+static uint8_t nvLogReady = false;
+static uint8_t nvLogPages;
+static uint8_t nvLogPage;               // page written to
+static uint32_t nvLogOfs;               // write pointer in nvLogPage
+static uint32_t nvLogSeq;               // seq of the next record
+static uint8_t nvLogBuf[sizeof(nvLog_hdr_t) + NV_LOG_MAX_DATA];     // record being written
+
+static uint32_t nvLog_now(void)
+{
+    return (uint32_t)(((uint64_t)ClockP_getSystemTicks() * ClockP_getSystemTickPeriod()) / 1000);
+}
+
+static uint8_t nvLog_crc(const nvLog_hdr_t *pHdr, const uint8_t *pData)
+{
+    nvLog_hdr_t hdr = *pHdr;
+    crc_t crc = crc_init();
+
+    hdr.crc = 0;
+    crc = crc_update(crc, &hdr, sizeof(hdr));
+    crc = crc_update(crc, pData, pHdr->len);
+    return crc_finalize(crc);
+}
+
+static bool nvLog_readPageHdr(uint8_t pg, nvLog_pageHdr_t *pHdr)
+{
+    if (NVS_read(nvLogHandle, pg * nvLogAttrs.sectorSize, pHdr, sizeof(*pHdr)) != NVS_STATUS_SUCCESS)
+    { return false; }
+    return (pHdr->magic == NV_LOG_MAGIC);
+}
+
+/*
+ * Read the record at ofs of page pg into pHdr/pData.
+ * Returns false at free space or at a record which is not intact.
+ */
+static bool nvLog_readRecord(uint8_t pg, uint32_t ofs, nvLog_hdr_t *pHdr, uint8_t *pData)
+{
+    size_t base = pg * nvLogAttrs.sectorSize;
+
+    if (ofs + sizeof(nvLog_hdr_t) > nvLogAttrs.sectorSize ||
+        NVS_read(nvLogHandle, base + ofs, pHdr, sizeof(nvLog_hdr_t)) != NVS_STATUS_SUCCESS ||
+        pHdr->len == NV_LOG_FREE_LEN || pHdr->len > NV_LOG_MAX_DATA ||
+        ofs + sizeof(nvLog_hdr_t) + pHdr->len > nvLogAttrs.sectorSize)
+    { return false; }
+
+    if (pHdr->len > 0 &&
+        NVS_read(nvLogHandle, base + ofs + sizeof(nvLog_hdr_t), pData, pHdr->len) != NVS_STATUS_SUCCESS)
+    { return false; }
+
+    return (nvLog_crc(pHdr, pData) == pHdr->crc);
+}
+
+/* Erase the page and make it the one written to */
+static uint8_t nvLog_startPage(uint8_t pg)
+{
+    nvLog_pageHdr_t pageHdr = { NV_LOG_MAGIC, 0 };
+
+    pageHdr.seq = nvLogSeq;
+    if (NVS_erase(nvLogHandle, pg * nvLogAttrs.sectorSize, nvLogAttrs.sectorSize) != NVS_STATUS_SUCCESS ||
+        NVS_write(nvLogHandle, pg * nvLogAttrs.sectorSize, &pageHdr, sizeof(pageHdr),
+                  NVS_WRITE_POST_VERIFY) != NVS_STATUS_SUCCESS)
+    { return NVINTF_FAILURE; }
+
+    nvLogPage = pg;
+    nvLogOfs = sizeof(nvLog_pageHdr_t);
+    return NVINTF_SUCCESS;
+}
+
+/* Find the newest page and the write pointer in it */
+static uint8_t nvLog_recover(void)
+{
+    nvLog_pageHdr_t pageHdr;
+    nvLog_hdr_t hdr;
+    uint32_t newestSeq = 0;
+    uint8_t newest = nvLogPages;
+    uint8_t pg, i;
+
+    for (pg = 0; pg < nvLogPages; pg++)
+    {
+        if (nvLog_readPageHdr(pg, &pageHdr) &&
+            (newest == nvLogPages || (int32_t)(pageHdr.seq - newestSeq) > 0))
+        {
+            newest = pg;
+            newestSeq = pageHdr.seq;
+        }
+    }
+
+    if (newest == nvLogPages)
+    {
+        // Empty or foreign content, start over
+        nvLogSeq = 0;
+        return nvLog_startPage(0);
+    }
+
+    nvLogPage = newest;
+    nvLogSeq = newestSeq;
+    nvLogOfs = sizeof(nvLog_pageHdr_t);
+    while (nvLog_readRecord(nvLogPage, nvLogOfs, &hdr, nvLogBuf))
+    {
+        nvLogSeq = hdr.seq + 1;
+        nvLogOfs += NV_LOG_ALIGN(sizeof(nvLog_hdr_t) + hdr.len);
+    }
+
+    // Stopped at free space only if the whole header is erased
+    if (nvLogOfs + sizeof(nvLog_hdr_t) <= nvLogAttrs.sectorSize)
+    {
+        NVS_read(nvLogHandle, nvLogPage * nvLogAttrs.sectorSize + nvLogOfs, &hdr, sizeof(hdr));
+        for (i = 0; i < sizeof(hdr); i++)
+        {
+            if (((uint8_t *)&hdr)[i] != 0xFF)
+            {
+                nvLogOfs = nvLogAttrs.sectorSize;   // go on in the next page
+                break;
+            }
+        }
+    }
+
+    return NVINTF_SUCCESS;
+}
+
+/*
+ * Open the log region and find the write pointer, then append a
+ * NV_LOG_BOOT record. Call from a task once the RTOS is running.
+ */
+uint8_t nvLog_init(void)
+{
+    uint8_t status;
+
+    if (nvLogHandle == NULL)
+    {
+        NVS_init();
+        nvLogHandle = NVS_open(NV_LOG_NVS_INDEX, NULL);
+        if (nvLogHandle == NULL)
+        { return NVINTF_NOTREADY; }
+
+        if (pthread_mutex_init(&nvLogMutex, NULL) != 0)
+        { while (1) {} /* Error creating mutex */ }
+
+        NVS_getAttrs(nvLogHandle, &nvLogAttrs);
+        nvLogPages = nvLogAttrs.regionSize / nvLogAttrs.sectorSize;
+    }
+
+    if (!nvLogReady)
+    {
+        if (nvLogPages < 2)
+        { return NVINTF_FAILURE; }  // the oldest page is erased while the newest is kept
+
+        pthread_mutex_lock(&nvLogMutex);
+        status = nvLog_recover();
+        pthread_mutex_unlock(&nvLogMutex);
+        if (status != NVINTF_SUCCESS)
+        { return status; }
+
+        nvLogReady = true;
+    }
+
+    return nvLog_append(NV_LOG_BOOT, NULL, 0);
+}
+
+/* Write one record, nvLogMutex held */
+static uint8_t nvLog_write(uint8_t type, const void *pData, uint16_t len)
+{
+    nvLog_hdr_t hdr;
+    uint32_t size = NV_LOG_ALIGN(sizeof(nvLog_hdr_t) + len);
+    uint8_t status = NVINTF_SUCCESS;
+
+    if (nvLogOfs + size > nvLogAttrs.sectorSize)
+    { status = nvLog_startPage((nvLogPage + 1) % nvLogPages); }
+
+    if (status == NVINTF_SUCCESS)
+    {
+        hdr.len = len;
+        hdr.type = type;
+        hdr.seq = nvLogSeq;
+        hdr.time = nvLog_now();
+        if (len > 0)
+        { memcpy(&nvLogBuf[sizeof(hdr)], pData, len); }
+        hdr.crc = nvLog_crc(&hdr, &nvLogBuf[sizeof(hdr)]);
+        memcpy(nvLogBuf, &hdr, sizeof(hdr));
+
+        if (NVS_write(nvLogHandle, nvLogPage * nvLogAttrs.sectorSize + nvLogOfs, nvLogBuf,
+                      sizeof(hdr) + len, NVS_WRITE_POST_VERIFY) == NVS_STATUS_SUCCESS)
+        {
+            nvLogSeq++;
+            nvLogOfs += size;
+        }
+        else
+        {
+            // The page may be worn or partly programmed, never written twice:
+            // the next record starts the next page
+            status = NVINTF_FAILURE;
+            nvLogOfs = nvLogAttrs.sectorSize;
+        }
+    }
+
+    return status;
+}
+
+static uint8_t nvLog_checkArgs(const void *pData, uint16_t len)
+{
+    if (!nvLogReady)
+    { return NVINTF_NOTREADY; }
+    if (len > NV_LOG_MAX_DATA)
+    { return NVINTF_BADLENGTH; }
+    if (len > 0 && pData == NULL)
+    { return NVINTF_BADPARAM; }
+    return NVINTF_SUCCESS;
+}
+
+/* Append one record, O(1): one write, plus a page erase when the page is full */
+uint8_t nvLog_append(uint8_t type, const void *pData, uint16_t len)
+{
+    uint8_t status = nvLog_checkArgs(pData, len);
+
+    if (status != NVINTF_SUCCESS)
+    { return status; }
+
+    pthread_mutex_lock(&nvLogMutex);
+    status = nvLog_write(type, pData, len);
+    pthread_mutex_unlock(&nvLogMutex);
+    return status;
+}
+
+/*
+ * nvLog_append() which does not wait for the log: NVINTF_FAILURE when it is
+ * in use, e.g. by the thread calling from an assert. Not from interrupts.
+ */
+uint8_t nvLog_tryAppend(uint8_t type, const void *pData, uint16_t len)
+{
+    uint8_t status = nvLog_checkArgs(pData, len);
+
+    if (status != NVINTF_SUCCESS)
+    { return status; }
+
+    if (pthread_mutex_trylock(&nvLogMutex) != 0)
+    { return NVINTF_FAILURE; }
+    status = nvLog_write(type, pData, len);
+    pthread_mutex_unlock(&nvLogMutex);
+    return status;
+}
+
+/*
+ * Call cb for each record, oldest first. The log is not locked while cb
+ * runs, records appended meanwhile may or may not be reported.
+ */
+uint8_t nvLog_read(nvLog_readCb_t cb, void *arg)
+{
+    nvLog_pageHdr_t pageHdr;
+    nvLog_hdr_t hdr;
+    uint8_t data[NV_LOG_MAX_DATA];
+    uint8_t newest, pg, i;
+    uint32_t ofs, end;
+
+    if (!nvLogReady)
+    { return NVINTF_NOTREADY; }
+    if (cb == NULL)
+    { return NVINTF_BADPARAM; }
+
+    pthread_mutex_lock(&nvLogMutex);
+    newest = nvLogPage;
+    end = nvLogOfs;
+    pthread_mutex_unlock(&nvLogMutex);
+
+    // The page after the newest is the oldest one
+    for (i = 1; i <= nvLogPages; i++)
+    {
+        pg = (newest + i) % nvLogPages;
+        if (!nvLog_readPageHdr(pg, &pageHdr))
+        { continue; }
+
+        for (ofs = sizeof(nvLog_pageHdr_t);
+             (pg != newest || ofs < end) && nvLog_readRecord(pg, ofs, &hdr, data);
+             ofs += NV_LOG_ALIGN(sizeof(nvLog_hdr_t) + hdr.len))
+        {
+            if (!cb(&hdr, data, arg))
+            { return NVINTF_SUCCESS; }
+        }
+    }
+
+    return NVINTF_SUCCESS;
+}
+
+/* Drop all records, record numbers go on */
+uint8_t nvLog_erase(void)
+{
+    uint8_t status = NVINTF_SUCCESS;
+    uint8_t pg;
+
+    if (!nvLogReady)
+    { return NVINTF_NOTREADY; }
+
+    pthread_mutex_lock(&nvLogMutex);
+    for (pg = 1; pg < nvLogPages; pg++)
+    {
+        if (NVS_erase(nvLogHandle, pg * nvLogAttrs.sectorSize, nvLogAttrs.sectorSize) != NVS_STATUS_SUCCESS)
+        { status = NVINTF_FAILURE; }
+    }
+    if (status == NVINTF_SUCCESS)
+    { status = nvLog_startPage(0); }  // erases page 0
+    pthread_mutex_unlock(&nvLogMutex);
+    return status;
+}
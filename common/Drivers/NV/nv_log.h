@@ -0,0 +1,51 @@
+/******************************************************************************
+
+@file  nv_log.h
+
+@brief Append-only record log in its own NVS region, see nv_log.c
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+#ifndef COMMON_DRIVERS_NV_NV_LOG_H_
+#define COMMON_DRIVERS_NV_NV_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nvintf.h"
+
+#define NV_LOG_MAX_DATA         48      // data bytes per record
+
+/* Record types */
+#define NV_LOG_BOOT             0x01    // written by nvLog_init(), no data
+#define NV_LOG_ASSERT           0x02    // stack assert: cause, subcause
+#define NV_LOG_DISCONN          0x03    // link terminated: handle (LE16), reason
+#define NV_LOG_THROUGHPUT       0x04    // transparent mode session: bytes to BLE, bytes to UART, ms (LE32 each)
+
+/* Record header as stored in flash, followed by len data bytes */
+typedef struct
+{
+    uint16_t len;       // data bytes, 0xFFFF: free space
+    uint8_t  type;
+    uint8_t  crc;       // CRC-8 (crc.h) of the header, crc 0, and the data
+    uint32_t seq;       // record number, counts on across resets
+    uint32_t time;      // ms since boot
+} nvLog_hdr_t;
+
+/* Called for each record, oldest first. Return false to stop. */
+typedef bool (*nvLog_readCb_t)(const nvLog_hdr_t *pHdr, const uint8_t *pData, void *arg);
+
+uint8_t nvLog_init(void);
+uint8_t nvLog_append(uint8_t type, const void *pData, uint16_t len);
+uint8_t nvLog_tryAppend(uint8_t type, const void *pData, uint16_t len);
+uint8_t nvLog_read(nvLog_readCb_t cb, void *arg);
+uint8_t nvLog_erase(void);
+
+#endif /* COMMON_DRIVERS_NV_NV_LOG_H_ */
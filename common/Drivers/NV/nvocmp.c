@@ -149,6 +149,8 @@ NVOCMP_STATS - Places a protected item with driver stats
 
 NVOCMP_CRCONREAD (on:1 off:0) - item crc is checked on read. Disabling this may
 increase driver speed but safety is reduced.
+The CRC is computed directly out of flash when the NVS region is memory
+mapped (internal flash), with the slice-by-4 loop of crc.c (CRC_SLICES).
 
 NVOCMP_NVS_INDEX - The index of the NVS_Config structure which describes the
 flash sector that NVOCMP should use. Default is 0.
@@ -172,6 +174,22 @@ is enabled by default on this family of devices.
 NVOCMP_RAM_BUFFER_SIZE - Sets the size for the RAM buffer used when
 RAM optimization is enabled. Default value is 500.
 
+NVOCMP_WEAR_STATS - Counts page erases and compactions with their duration,
+and enables NVOCMP_getWearStats() to read them together with the page cycle
+counts and the live, dead and free bytes. NVOCMP_FLASH_ENDURANCE (nvocmp.h)
+gives the erase cycles of a page for lifetime estimates. More pages
+(NVOCMP_NVPAGES, up to the NVS region size) spread the erases.
+
+NVOCMP_RAM_INDEX_SIZE - Number of items in the RAM item index. The index is a
+hash table with a third more slots than items, 12 bytes per slot.
+The index keeps the location of the newest active copy of an item, so that
+exact (FINDSTRICT) lookups read one header instead of scanning the page
+backwards. It is built at init, updated on write and delete and rebuilt after
+compaction. When there are more items than entries, an item found by scanning
+replaces the least recently used entry, so the items in use stay indexed;
+only lookups of items which do not exist still scan. Default value is 0, no
+index.
+
 Dependencies:
 Requires NVS for NV access.
 Requires TI-RTOS GateMutexPri or POSIX mutex to be enabled in configuration.
@@ -192,6 +210,9 @@ Requires API's in a crc.h to implement CRC functionality.
 #endif
 #include "nvocmp.h"
 #include "crc.h"
+#if defined(NVOCMP_WEAR_STATS) && !defined(NV_LINUX)
+#include <ti/drivers/dpl/ClockP.h>
+#endif
 #ifndef NV_LINUX
 
 /* CC23X0 and CC27XX does not support GPRAM,
@@ -230,6 +251,10 @@ Requires API's in a crc.h to implement CRC functionality.
 #define NVOCMP_NWSAMEITEM   0           // Not Write Same Item
 #endif
 
+#ifndef NVOCMP_RAM_INDEX_SIZE
+#define NVOCMP_RAM_INDEX_SIZE 0         // RAM Item Index Entries, 0: disabled
+#endif
+
 #ifndef NVOCMP_MIGRATE_ENABLED
 #define NVOCMP_MIGRATE_DISABLED         // Migration from old NVOCTP disabled by default
 #endif
@@ -246,11 +271,7 @@ Requires API's in a crc.h to implement CRC functionality.
 #define NVOCMP_NVS_INDEX    0
 #endif // NVOCMP_NVS_INDEX
 
-// Maximum ID parameters - must be coordinated with header format
-#define NVOCMP_MAXSYSID     0x003F  //  6 bits
-#define NVOCMP_MAXITEMID    0x03FF  // 10 bits
-#define NVOCMP_MAXSUBID     0x03FF  // 10 bits
-#define NVOCMP_MAXLEN       0x0FFF  // 12 bits
+// Maximum ID parameters (NVOCMP_MAXxxx) are in nvocmp.h
 #define NVOCMP_INVALIDSUBID 0xFFFF  // Invalid Sub Id
 
 // Contents of an erased Flash memory locations
@@ -647,6 +668,34 @@ typedef struct
   NVOCMP_compactInfo_t compactInfo;
   NVOCMP_pageInfo_t pageInfo[NVOCMP_NVPAGES];
 } NVOCMP_nvHandle_t;
+
+#if NVOCMP_RAM_INDEX_SIZE
+// RAM index states
+#define NVOCMP_INDEXINVALID   0   // rebuild before use
+#define NVOCMP_INDEXPARTIAL   1   // some items did not fit, search flash on a miss
+#define NVOCMP_INDEXCOMPLETE  2   // every active item is in the index
+
+// Linear probing, the spare slots keep the probes short
+#define NVOCMP_INDEXSLOTS     (NVOCMP_RAM_INDEX_SIZE + NVOCMP_RAM_INDEX_SIZE / 3 + 1)
+#define NVOCMP_INDEXHOME(c)   ((uint16_t)(((uint32_t)(c) * 2654435761u) >> 16) % NVOCMP_INDEXSLOTS)
+#define NVOCMP_INDEXNEXT(i)   (((i) + 1) % NVOCMP_INDEXSLOTS)
+
+typedef struct
+{
+  uint32_t cmpid;   // compressed item ID
+  uint16_t hofs;    // offset of the item header
+  uint16_t used;    // index clock of the last use
+  uint8_t  hpage;   // page of the item header, NVOCMP_NULLPAGE: free slot
+} NVOCMP_indexEntry_t;
+
+typedef struct
+{
+  uint8_t state;
+  uint16_t count;
+  uint16_t clock;   // counts lookups and updates, for the LRU eviction
+  NVOCMP_indexEntry_t entry[NVOCMP_INDEXSLOTS];
+} NVOCMP_index_t;
+#endif
 //*****************************************************************************
 // Local variables
 //*****************************************************************************
@@ -696,6 +745,11 @@ static GateMutexPri_Handle NVOCMP_gMutexPri;
 // Small NV Item Buffer, for item construction
 static uint8_t NVOCMP_itemBuffer[NVOCMP_SMALLITEM];
 
+#if NVOCMP_RAM_INDEX_SIZE
+// Location of the newest active copy of each item
+static NVOCMP_index_t NVOCMP_index;
+#endif
+
 // Function Pointer to an optional user provided voltage check function
 static bool (*NVOCMP_voltCheckFptr)(void);
 // Diagnostic counter for bad CRCs
@@ -703,6 +757,11 @@ static bool (*NVOCMP_voltCheckFptr)(void);
 static uint16_t NVOCMP_badCRCCount = 0;
 #endif // NVOCMP_STATS
 
+#ifdef NVOCMP_WEAR_STATS
+// Erase and compaction counters, the other figures are read when asked
+static NVOCMP_wearStats_t NVOCMP_wearStats;
+#endif // NVOCMP_WEAR_STATS
+
 NVOCMP_initAction_t gAction;
 uint8_t NVOCMP_size;
 
@@ -740,6 +799,8 @@ static uint32_t   NVOCMP_sanityCheckApi (void);
 static void       NVOCMP_initNv(NVOCMP_nvHandle_t *pNvHandle);
 static uint8_t    NVOCMP_scanPage(NVOCMP_nvHandle_t *pNvHandle, uint8_t pg,
                                   NVOCMP_pageInfo_t *pPageInfo);
+static bool       NVOCMP_scanBatch(NVOCMP_nvHandle_t *pNvHandle, NVOCMP_batchItem_t *pItems,
+                                   uint16_t count, uint16_t left);
 static int8_t     NVOCMP_findItem(NVOCMP_nvHandle_t *pNvHandle, uint8_t pg, uint16_t ofs,
                                   NVOCMP_itemHdr_t *pHdr, int8_t flag, NVOCMP_itemInfo_t *pInfo);
 static uint8_t    NVOCMP_addItem(NVOCMP_nvHandle_t *pNvHandle, NVOCMP_itemHdr_t *iHdr,
@@ -748,6 +809,7 @@ static void       NVOCMP_writeItem(NVOCMP_nvHandle_t *pNvHandle, NVOCMP_itemHdr_
                                    uint8_t dstPg, uint16_t dstOff, uint8_t *pBuf);
 static uint8_t    NVOCMP_erase(NVOCMP_nvHandle_t *pNvHandle, uint8_t dstPg);
 static int16_t    NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes);
+static int16_t    NVOCMP_doCompactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes);
 static NVOCMP_compactStatus_t NVOCMP_compact(NVOCMP_nvHandle_t *pNvHandle);
 static uint8_t    NVOCMP_getDstPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t len);
 static void       NVOCMP_changePageState(NVOCMP_nvHandle_t *pNvHandle, uint8_t pg,
@@ -772,6 +834,14 @@ static uint8_t    NVOCMP_verifyCRC(uint16_t iOfs, uint16_t len, uint8_t crc, uin
 static uint8_t    NVOCMP_readByte(uint8_t pg, uint16_t ofs);
 static void       NVOCMP_writeByte(uint8_t pg, uint16_t ofs, uint8_t bwv);
 
+#if NVOCMP_RAM_INDEX_SIZE
+static void       NVOCMP_indexBuild(NVOCMP_nvHandle_t *pNvHandle);
+static bool       NVOCMP_indexFind(NVOCMP_nvHandle_t *pNvHandle, NVOCMP_itemHdr_t *pHdr,
+                                   uint32_t cid, int8_t *pStatus);
+static void       NVOCMP_indexUpdate(uint32_t cid, uint8_t pg, uint16_t hofs);
+static void       NVOCMP_indexRemove(uint8_t pg, uint16_t hofs);
+#endif
+
 #if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
 static uint8_t    NVOCMP_findDstPage(NVOCMP_nvHandle_t *pNvHandle);
 static uint8_t    NVOCMP_cleanPage(NVOCMP_nvHandle_t *pNvHandle);
@@ -970,6 +1040,83 @@ static bool NVOCMP_checkVoltage(void)
 }
 #endif
 
+#ifdef NVOCMP_WEAR_STATS
+/**
+ * @fn      NVOCMP_getWearStats
+ *
+ * @brief   Global function to read the NV wear figures
+ *
+ * @param   pStats - pointer to caller's buffer
+ *
+ * @return  NVINTF_SUCCESS or NVINTF_BADPARAM
+ */
+extern uint8_t NVOCMP_getWearStats(NVOCMP_wearStats_t *pStats)
+{
+    NVOCMP_nvHandle_t *pNvHandle = &NVOCMP_nvHandle;
+    uint8_t p;
+    uint16_t ofs;
+    NVOCMP_itemHdr_t iHdr;
+#if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
+    uint16_t nvSearched = 0;
+#endif
+
+    if(pStats == NULL)
+    {
+        return(NVINTF_BADPARAM);
+    }
+
+    NVOCMP_LOCK();
+
+    memcpy(pStats, &NVOCMP_wearStats, sizeof(NVOCMP_wearStats_t));
+    pStats->nvPages = pNvHandle->nvSize;
+    for(p = 0; p < pNvHandle->nvSize && p < NVOCMP_MAX_NVPAGES; p++)
+    {
+        pStats->cycle[p] = pNvHandle->pageInfo[p].cycle;
+    }
+    pStats->freeBytes = NVOCMP_getFreeNvApi();
+
+    // Walk the items from the newest back, as NVOCMP_findItem() does
+    p = pNvHandle->actPage;
+    ofs = pNvHandle->actOffset;
+#if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
+    for(p = pNvHandle->actPage; nvSearched < NVOCMP_NVSIZE; p = NVOCMP_DECPAGE(p), ofs = pNvHandle->pageInfo[p].offset)
+    {
+      nvSearched++;
+      if(p == pNvHandle->tailPage)
+      {
+        continue;
+      }
+#endif
+      while(ofs >= (NVOCMP_PGDATAOFS + NVOCMP_ITEMHDRLEN))
+      {
+          ofs -= NVOCMP_ITEMHDRLEN;
+          NVOCMP_readHeader(p, ofs, &iHdr, false);
+
+          if(!(iHdr.stats & NVOCMP_FOLLOWBIT) || (iHdr.len >= ofs))
+          {
+              // Corrupted, the rest of the page is dead
+              pStats->deadBytes += ofs + NVOCMP_ITEMHDRLEN - NVOCMP_PGDATAOFS;
+              break;
+          }
+
+          if((iHdr.stats & NVOCMP_ACTIVEIDBIT) && !(iHdr.stats & NVOCMP_VALIDIDBIT))
+          {
+              pStats->liveBytes += iHdr.len + NVOCMP_ITEMHDRLEN;
+          }
+          else
+          {
+              pStats->deadBytes += iHdr.len + NVOCMP_ITEMHDRLEN;
+          }
+          ofs -= iHdr.len;
+      }
+#if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
+    }
+#endif
+
+    NVOCMP_UNLOCK(NVINTF_SUCCESS);
+}
+#endif
+
 #ifdef NVDEBUG
 void NVOCMP_corruptData(uint8_t pg, uint16_t off, uint16_t len, uint8_t buf)
 {
@@ -1082,6 +1229,10 @@ static uint8_t NVOCMP_initNvApi(void *param)
 
         NVOCMP_initNv(&NVOCMP_nvHandle);
 
+#if NVOCMP_RAM_INDEX_SIZE
+        NVOCMP_indexBuild(&NVOCMP_nvHandle);
+#endif
+
 #if defined (NVOCMP_STATS)
         {
             uint8_t err;
@@ -1662,6 +1813,156 @@ static uint8_t NVOCMP_writeItemApi(NVINTF_itemID_t id, uint16_t len, void *pBuf)
     NVOCMP_UNLOCK(err);
 }
 
+/******************************************************************************
+ * @fn      NVOCMP_readBatch
+ *
+ * @brief   Global function to read several NV items with one lock and one pass
+ *          over NV. Each item is read like readItem(id, 0, len, buffer).
+ *
+ * @param   pItems - items to read, status is set for each of them
+ * @param   count - number of items
+ *
+ * @return  NVINTF_SUCCESS or the status of the first item which failed
+ */
+uint8_t NVOCMP_readBatch(NVOCMP_batchItem_t *pItems, uint16_t count)
+{
+    uint8_t err = NVINTF_SUCCESS;
+    uint16_t left = 0;
+    uint16_t i;
+    NVOCMP_itemHdr_t iHdr;
+
+    // Parameter Sanity Check
+    if (pItems == NULL || count == 0)
+    {
+        return(NVINTF_BADPARAM);
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        if(pItems[i].buffer == NULL || pItems[i].len == 0)
+        {
+            pItems[i].status = NVINTF_BADPARAM;
+        }
+        else
+        {
+            pItems[i].status = NVOCMP_checkItem(&pItems[i].id, pItems[i].len, &iHdr,
+                                                NVOCMP_FINDSTRICT);
+        }
+        if(pItems[i].status == NVINTF_SUCCESS)
+        {
+            // Until seen on the way through NV
+            pItems[i].status = NVINTF_NOTFOUND;
+            left++;
+        }
+    }
+
+    // Prevent RTOS thread contention
+    NVOCMP_LOCK();
+
+    if(left && !NVOCMP_scanBatch(&NVOCMP_nvHandle, pItems, count, left))
+    {
+        // Corruption found, the single item search recovers from it
+        for(i = 0; i < count; i++)
+        {
+            if(pItems[i].status == NVINTF_NOTFOUND)
+            {
+                (void)NVOCMP_checkItem(&pItems[i].id, pItems[i].len, &iHdr, NVOCMP_FINDSTRICT);
+                pItems[i].status = NVOCMP_findItem(&NVOCMP_nvHandle, NVOCMP_nvHandle.actPage,
+                                                   NVOCMP_nvHandle.actOffset, &iHdr,
+                                                   NVOCMP_FINDSTRICT, NULL);
+                if(pItems[i].status == NVINTF_SUCCESS)
+                {
+                    pItems[i].status = NVOCMP_readItem(&iHdr, 0, pItems[i].len,
+                                                       pItems[i].buffer, false);
+                }
+            }
+        }
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        if(pItems[i].status != NVINTF_SUCCESS)
+        {
+            err = pItems[i].status;
+            break;
+        }
+    }
+
+    NVOCMP_UNLOCK(err);
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_writeBatch
+ *
+ * @brief   Global function to write several NV items under one lock. Each item
+ *          is written like writeItem(id, len, buffer), creating it if needed.
+ *
+ * @param   pItems - items to write, status is set for each of them
+ * @param   count - number of items
+ *
+ * @return  NVINTF_SUCCESS or the status of the first item which failed
+ */
+uint8_t NVOCMP_writeBatch(NVOCMP_batchItem_t *pItems, uint16_t count)
+{
+    uint8_t err = NVINTF_SUCCESS;
+    uint8_t status;
+    uint16_t i;
+    NVOCMP_itemHdr_t iHdr;
+
+    // Parameter Sanity Check
+    if (pItems == NULL || count == 0)
+    {
+        return(NVINTF_BADPARAM);
+    }
+
+    // Check voltage if possible
+    NVOCMP_FLASHACCESS(err)
+    if(err)
+    {
+      return(err);
+    }
+
+    // Prevent RTOS thread contention
+    NVOCMP_LOCK();
+
+    for(i = 0; i < count; i++)
+    {
+        if(pItems[i].buffer == NULL || pItems[i].len == 0)
+        {
+            status = NVINTF_BADPARAM;
+        }
+        else
+        {
+            status = NVOCMP_checkItem(&pItems[i].id, pItems[i].len, &iHdr, NVOCMP_FINDSTRICT);
+        }
+
+        if(status == NVINTF_SUCCESS)
+        {
+            // Create a new item
+            status = NVOCMP_addItem(&NVOCMP_nvHandle, &iHdr, pItems[i].buffer, NVOCMP_WRITE);
+            if((status == NVINTF_SUCCESS) && (iHdr.hofs > 0))
+            {
+                // Mark old item as inactive
+                NVOCMP_setItemInactive(&NVOCMP_nvHandle, iHdr.hpage, iHdr.hofs);
+
+                status = NVOCMP_failW;
+            }
+        }
+
+        pItems[i].status = status;
+        if((status != NVINTF_SUCCESS) && (err == NVINTF_SUCCESS))
+        {
+            err = status;
+        }
+    }
+
+#ifdef NV_LINUX
+    NV_LINUX_save();
+#endif
+
+    NVOCMP_UNLOCK(err);
+}
+
 //*****************************************************************************
 // Extended API Functions
 //*****************************************************************************
@@ -3087,6 +3388,9 @@ static uint8_t NVOCMP_erase(NVOCMP_nvHandle_t *pNvHandle, uint8_t dstPg)
         }
         else
         {
+#ifdef NVOCMP_WEAR_STATS
+          NVOCMP_wearStats.erases++;
+#endif
           // Bump the compaction cycle counter, wrap-around if at maximum
           pNvHandle->pageInfo[dstPg].cycle = (pNvHandle->pageInfo[dstPg].cycle < NVOCMP_MAXCYCLE) ?
                                            (pNvHandle->pageInfo[dstPg].cycle + 1) : NVOCMP_MINCYCLE;
@@ -3096,6 +3400,10 @@ static uint8_t NVOCMP_erase(NVOCMP_nvHandle_t *pNvHandle, uint8_t dstPg)
           NVOCMP_setCompactHdr(dstPg, NVOCMP_NULLPAGE, NVOCMP_NULLOFFSET, XSRCENDHDR);
           pNvHandle->pageInfo[dstPg].offset = NVOCMP_PGDATAOFS;
           pNvHandle->pageInfo[dstPg].mode = NVOCMP_PGNORMAL;
+#if NVOCMP_RAM_INDEX_SIZE
+          // Items of this page are gone, rebuild on next lookup
+          NVOCMP_index.state = NVOCMP_INDEXINVALID;
+#endif
         }
     }
     else
@@ -3251,6 +3559,13 @@ static void NVOCMP_writeItem(NVOCMP_nvHandle_t *pNvHandle, NVOCMP_itemHdr_t *pHd
         {
             NVOCMP_setItemInactive(pNvHandle, dstPg, hOfs);
         }
+#if NVOCMP_RAM_INDEX_SIZE
+        else
+        {
+            NVOCMP_indexUpdate(NVOCMP_CMPRID(pHdr->sysid, pHdr->itemid, pHdr->subid),
+                               dstPg, hOfs);
+        }
+#endif
     }
     else
     {
@@ -3427,6 +3742,10 @@ static void NVOCMP_setItemInactive(NVOCMP_nvHandle_t *pNvHandle, uint8_t pg,
     // Mark the item as inactive
     NVOCMP_writeByte(pg, iOfs + NVOCMP_HDRVLDOFS, tmp);
 
+#if NVOCMP_RAM_INDEX_SIZE
+    NVOCMP_indexRemove(pg, iOfs);
+#endif
+
     if(pNvHandle->pageInfo[pg].allActive)
     {
       tmp = NVOCMP_readByte(pg, NVOCMP_PGHDRVER);
@@ -3816,6 +4135,21 @@ static int8_t NVOCMP_findItem(NVOCMP_nvHandle_t *pNvHandle, uint8_t pg, uint16_t
     uint16_t items = 0;
     uint32_t cid = NVOCMP_CMPRID(pHdr->sysid,pHdr->itemid,pHdr->subid);
 
+#if NVOCMP_RAM_INDEX_SIZE
+    // Exact lookups of the newest copy are answered by the RAM index
+    bool indexed = (flag == NVOCMP_FINDSTRICT) && (pg == pNvHandle->actPage) &&
+                   (ofs == pNvHandle->actOffset);
+    if(indexed)
+    {
+        int8_t status;
+
+        if(NVOCMP_indexFind(pNvHandle, pHdr, cid, &status))
+        {
+            return(status);
+        }
+    }
+#endif
+
 #if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
     uint16_t nvSearched = 0;
     for(p = pg; nvSearched < NVOCMP_NVSIZE; p = NVOCMP_DECPAGE(p), ofs = pNvHandle->pageInfo[p].offset)
@@ -3891,6 +4225,13 @@ static int8_t NVOCMP_findItem(NVOCMP_nvHandle_t *pNvHandle, uint8_t pg, uint16_t
                 }
                 else
                 {
+#if NVOCMP_RAM_INDEX_SIZE
+                  // Missed by the index, keep it for the next lookup
+                  if(indexed)
+                  {
+                      NVOCMP_indexUpdate(cid, p, ofs);
+                  }
+#endif
                   memcpy(pHdr, &iHdr, sizeof(NVOCMP_itemHdr_t));
                   return(NVINTF_SUCCESS);
                 }
@@ -3950,6 +4291,393 @@ static int8_t NVOCMP_findItem(NVOCMP_nvHandle_t *pNvHandle, uint8_t pg, uint16_t
 }
 #endif
 
+#if NVOCMP_RAM_INDEX_SIZE
+/******************************************************************************
+ * @fn      NVOCMP_indexLookup
+ *
+ * @brief   Find the slot of an item
+ *
+ * @param   cid - compressed item ID
+ *
+ * @return  Slot number, -1 if the item is not in the index
+ */
+static int16_t NVOCMP_indexLookup(uint32_t cid)
+{
+    uint16_t i = NVOCMP_INDEXHOME(cid);
+
+    // There is always a free slot, it ends the probe
+    while(NVOCMP_index.entry[i].hpage != NVOCMP_NULLPAGE)
+    {
+        if(NVOCMP_index.entry[i].cmpid == cid)
+        {
+            return(i);
+        }
+        i = NVOCMP_INDEXNEXT(i);
+    }
+
+    return(-1);
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_indexAdd
+ *
+ * @brief   Put an item which is not in the index into a free slot, the
+ *          caller checks that the index is not full
+ *
+ * @param   cid - compressed item ID
+ *
+ * @return  Slot number
+ */
+static uint16_t NVOCMP_indexAdd(uint32_t cid)
+{
+    uint16_t i = NVOCMP_INDEXHOME(cid);
+
+    while(NVOCMP_index.entry[i].hpage != NVOCMP_NULLPAGE)
+    {
+        i = NVOCMP_INDEXNEXT(i);
+    }
+    NVOCMP_index.entry[i].cmpid = cid;
+    NVOCMP_index.count++;
+
+    return(i);
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_indexDelete
+ *
+ * @brief   Free a slot, moving back the entries of the probe behind it so
+ *          that no lookup stops early
+ *
+ * @param   i - slot number
+ *
+ * @return  none
+ */
+static void NVOCMP_indexDelete(uint16_t i)
+{
+    uint16_t j = i;
+    uint16_t home;
+
+    for(;;)
+    {
+        j = NVOCMP_INDEXNEXT(j);
+        if(NVOCMP_index.entry[j].hpage == NVOCMP_NULLPAGE)
+        {
+            break;
+        }
+
+        // An entry whose home is in (i, j] stays where it is
+        home = NVOCMP_INDEXHOME(NVOCMP_index.entry[j].cmpid);
+        if((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)))
+        {
+            continue;
+        }
+
+        NVOCMP_index.entry[i] = NVOCMP_index.entry[j];
+        i = j;
+    }
+
+    NVOCMP_index.entry[i].hpage = NVOCMP_NULLPAGE;
+    NVOCMP_index.count--;
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_indexEvict
+ *
+ * @brief   Drop the least recently used entry to make room
+ *
+ * @return  none
+ */
+static void NVOCMP_indexEvict(void)
+{
+    uint16_t i;
+    uint16_t oldest = 0;
+    uint16_t maxAge = 0;
+
+    for(i = 0; i < NVOCMP_INDEXSLOTS; i++)
+    {
+        if((NVOCMP_index.entry[i].hpage != NVOCMP_NULLPAGE) &&
+           ((uint16_t)(NVOCMP_index.clock - NVOCMP_index.entry[i].used) >= maxAge))
+        {
+            maxAge = NVOCMP_index.clock - NVOCMP_index.entry[i].used;
+            oldest = i;
+        }
+    }
+
+    NVOCMP_indexDelete(oldest);
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_indexBuild
+ *
+ * @brief   Fill the RAM index with the newest active copy of each item,
+ *          searching the same way as NVOCMP_findItem(). A corrupted page
+ *          leaves the index invalid, the search then finds and fixes it.
+ *
+ * @param   pNvHandle - pointer to NV handle
+ *
+ * @return  none
+ */
+static void NVOCMP_indexBuild(NVOCMP_nvHandle_t *pNvHandle)
+{
+    uint8_t p = pNvHandle->actPage;
+    uint16_t ofs = pNvHandle->actOffset;
+    uint16_t i;
+    NVOCMP_itemHdr_t iHdr;
+
+    NVOCMP_index.count = 0;
+    NVOCMP_index.state = NVOCMP_INDEXINVALID;
+    for(i = 0; i < NVOCMP_INDEXSLOTS; i++)
+    {
+        NVOCMP_index.entry[i].hpage = NVOCMP_NULLPAGE;
+    }
+
+    if(p == NVOCMP_NULLPAGE)
+    {
+        return;
+    }
+
+#if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
+    uint16_t nvSearched = 0;
+    for(p = pNvHandle->actPage; nvSearched < NVOCMP_NVSIZE; p = NVOCMP_DECPAGE(p), ofs = pNvHandle->pageInfo[p].offset)
+    {
+      nvSearched++;
+      if(p == pNvHandle->tailPage)
+      {
+        continue;
+      }
+#endif
+      while(ofs >= (NVOCMP_PGDATAOFS + NVOCMP_ITEMHDRLEN))
+      {
+          // Align to start of item header
+          ofs -= NVOCMP_ITEMHDRLEN;
+
+          NVOCMP_readHeader(p, ofs, &iHdr, false);
+
+          if(!(iHdr.stats & NVOCMP_FOLLOWBIT) || (iHdr.len >= ofs))
+          {
+              NVOCMP_ALERT(false, "NV index build stopped, corrupted item.")
+              return;
+          }
+
+          // The first copy found is the newest one
+          if((iHdr.stats & NVOCMP_ACTIVEIDBIT) &&
+            !(iHdr.stats & NVOCMP_VALIDIDBIT) &&
+            (NVOCMP_indexLookup(iHdr.cmpid) < 0))
+          {
+              if(NVOCMP_index.count < NVOCMP_RAM_INDEX_SIZE)
+              {
+                  i = NVOCMP_indexAdd(iHdr.cmpid);
+                  NVOCMP_index.entry[i].hpage = p;
+                  NVOCMP_index.entry[i].hofs = ofs;
+                  NVOCMP_index.entry[i].used = NVOCMP_index.clock;
+              }
+              else
+              {
+                  NVOCMP_index.state = NVOCMP_INDEXPARTIAL;
+              }
+          }
+
+          // Jump to next item
+          ofs -= iHdr.len;
+      }
+#if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
+    }
+#endif
+
+    if(NVOCMP_index.state != NVOCMP_INDEXPARTIAL)
+    {
+        NVOCMP_index.state = NVOCMP_INDEXCOMPLETE;
+    }
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_indexFind
+ *
+ * @brief   Look an item up in the RAM index. The header at the indexed
+ *          location is read back and checked before it is used.
+ *
+ * @param   pNvHandle - pointer to NV handle
+ * @param   pHdr - pointer to item header, filled in when found
+ * @param   cid - compressed item ID
+ * @param   pStatus - NVINTF_SUCCESS or NVINTF_NOTFOUND, when answered
+ *
+ * @return  true if answered, false if flash has to be searched
+ */
+static bool NVOCMP_indexFind(NVOCMP_nvHandle_t *pNvHandle, NVOCMP_itemHdr_t *pHdr,
+                             uint32_t cid, int8_t *pStatus)
+{
+    int16_t i;
+    NVOCMP_itemHdr_t iHdr;
+
+    if(NVOCMP_index.state == NVOCMP_INDEXINVALID)
+    {
+        NVOCMP_indexBuild(pNvHandle);
+        if(NVOCMP_index.state == NVOCMP_INDEXINVALID)
+        {
+            return(false);
+        }
+    }
+
+    i = NVOCMP_indexLookup(cid);
+    if(i < 0)
+    {
+        if(NVOCMP_index.state != NVOCMP_INDEXCOMPLETE)
+        {
+            return(false);
+        }
+        pHdr->hofs = 0;
+        *pStatus = NVINTF_NOTFOUND;
+        return(true);
+    }
+
+    NVOCMP_readHeader(NVOCMP_index.entry[i].hpage, NVOCMP_index.entry[i].hofs, &iHdr, false);
+    if((iHdr.cmpid != cid) ||
+       !(iHdr.stats & NVOCMP_ACTIVEIDBIT) ||
+       (iHdr.stats & NVOCMP_VALIDIDBIT))
+    {
+        NVOCMP_ALERT(false, "Stale NV index entry, searching flash.")
+        NVOCMP_index.state = NVOCMP_INDEXINVALID;
+        return(false);
+    }
+
+    NVOCMP_index.entry[i].used = ++NVOCMP_index.clock;
+    memcpy(pHdr, &iHdr, sizeof(NVOCMP_itemHdr_t));
+    *pStatus = NVINTF_SUCCESS;
+    return(true);
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_indexUpdate
+ *
+ * @brief   Point the index at the newest copy of an item, written or found
+ *          by a search. A full index drops its least recently used entry.
+ *
+ * @param   cid - compressed item ID
+ * @param   pg - page of the item header
+ * @param   hofs - offset of the item header
+ *
+ * @return  none
+ */
+static void NVOCMP_indexUpdate(uint32_t cid, uint8_t pg, uint16_t hofs)
+{
+    int16_t i;
+
+    if(NVOCMP_index.state == NVOCMP_INDEXINVALID)
+    {
+        return;
+    }
+
+    i = NVOCMP_indexLookup(cid);
+    if(i < 0)
+    {
+        if(NVOCMP_index.count >= NVOCMP_RAM_INDEX_SIZE)
+        {
+            NVOCMP_indexEvict();
+            NVOCMP_index.state = NVOCMP_INDEXPARTIAL;
+        }
+        i = NVOCMP_indexAdd(cid);
+    }
+
+    NVOCMP_index.entry[i].hpage = pg;
+    NVOCMP_index.entry[i].hofs = hofs;
+    NVOCMP_index.entry[i].used = ++NVOCMP_index.clock;
+}
+
+/******************************************************************************
+ * @fn      NVOCMP_indexRemove
+ *
+ * @brief   Drop the entry of an item copy which was marked inactive
+ *
+ * @param   pg - page of the item header
+ * @param   hofs - offset of the item header
+ *
+ * @return  none
+ */
+static void NVOCMP_indexRemove(uint8_t pg, uint16_t hofs)
+{
+    uint16_t i;
+
+    for(i = 0; i < NVOCMP_INDEXSLOTS; i++)
+    {
+        if((NVOCMP_index.entry[i].hpage == pg) && (NVOCMP_index.entry[i].hofs == hofs))
+        {
+            NVOCMP_indexDelete(i);
+            return;
+        }
+    }
+}
+#endif
+
+/******************************************************************************
+ * @fn      NVOCMP_scanBatch
+ *
+ * @brief   Read the items of a batch in one pass from the newest item back,
+ *          the first active copy found of each item is read.
+ *
+ * @param   pNvHandle - pointer to NV handle
+ * @param   pItems - batch items, those with NVINTF_NOTFOUND status are searched
+ * @param   count - number of items
+ * @param   left - number of items searched
+ *
+ * @return  false if a corrupted item stopped the pass
+ */
+static bool NVOCMP_scanBatch(NVOCMP_nvHandle_t *pNvHandle, NVOCMP_batchItem_t *pItems,
+                             uint16_t count, uint16_t left)
+{
+    uint8_t p = pNvHandle->actPage;
+    uint16_t ofs = pNvHandle->actOffset;
+    uint16_t i;
+    NVOCMP_itemHdr_t iHdr;
+
+#if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
+    uint16_t nvSearched = 0;
+    for(p = pNvHandle->actPage; left && (nvSearched < NVOCMP_NVSIZE); p = NVOCMP_DECPAGE(p), ofs = pNvHandle->pageInfo[p].offset)
+    {
+      nvSearched++;
+      if(p == pNvHandle->tailPage)
+      {
+        continue;
+      }
+#endif
+      while(left && (ofs >= (NVOCMP_PGDATAOFS + NVOCMP_ITEMHDRLEN)))
+      {
+          // Align to start of item header
+          ofs -= NVOCMP_ITEMHDRLEN;
+
+          NVOCMP_readHeader(p, ofs, &iHdr, false);
+
+          if(!(iHdr.stats & NVOCMP_FOLLOWBIT) || (iHdr.len >= ofs))
+          {
+              NVOCMP_ALERT(false, "Batch read stopped, corrupted item.")
+              return(false);
+          }
+
+          if((iHdr.stats & NVOCMP_ACTIVEIDBIT) &&
+            !(iHdr.stats & NVOCMP_VALIDIDBIT))
+          {
+              for(i = 0; i < count; i++)
+              {
+                  if((pItems[i].status == NVINTF_NOTFOUND) &&
+                     (NVOCMP_CMPRID(pItems[i].id.systemID, pItems[i].id.itemID,
+                                    pItems[i].id.subID) == iHdr.cmpid))
+                  {
+                      pItems[i].status = NVOCMP_readItem(&iHdr, 0, pItems[i].len,
+                                                         pItems[i].buffer, false);
+                      left--;
+                  }
+              }
+          }
+
+          // Jump to next item
+          ofs -= iHdr.len;
+      }
+#if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
+    }
+#endif
+
+    return(true);
+}
+
 #if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
 /******************************************************************************
  * @fn      NVOCMP_cleanPage
@@ -4019,7 +4747,7 @@ static uint8_t NVOCMP_cleanPage(NVOCMP_nvHandle_t *pNvHandle)
 
 #if (NVOCMP_NVPAGES > NVOCMP_NVTWOP)
 /******************************************************************************
- * @fn      NVOCMP_compactPage
+ * @fn      NVOCMP_doCompactPage
  *
  * @brief   Compact specified page by copying active items to other page
  *
@@ -4036,7 +4764,7 @@ static uint8_t NVOCMP_cleanPage(NVOCMP_nvHandle_t *pNvHandle)
  *
  * @return  Number of available bytes on compacted page, -1 if error
  */
-static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
+static int16_t NVOCMP_doCompactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
 {
   uint8_t pg;
   uint8_t mode;
@@ -4059,6 +4787,11 @@ static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
     return(0);
   }
 
+#if NVOCMP_RAM_INDEX_SIZE
+  // Items are moved, the index is rebuilt on the next lookup
+  NVOCMP_index.state = NVOCMP_INDEXINVALID;
+#endif
+
   srcPg = pNvHandle->headPage;
   dstPg = pNvHandle->tailPage;
   compactPages = NVOCMP_NVSIZE - 1;
@@ -4241,7 +4974,7 @@ static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
 }
 #else
 /******************************************************************************
- * @fn      NVOCMP_compactPage
+ * @fn      NVOCMP_doCompactPage
  *
  * @brief   Compact specified page by copying active items to other page
  *
@@ -4258,7 +4991,7 @@ static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
  *
  * @return  Number of available bytes on compacted page, -1 if error
  */
-static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
+static int16_t NVOCMP_doCompactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
 {
   uint8_t srcPg;
   uint8_t dstPg;
@@ -4274,6 +5007,11 @@ static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
     return(0);
   }
 
+#if NVOCMP_RAM_INDEX_SIZE
+  // Items are moved, the index is rebuilt on the next lookup
+  NVOCMP_index.state = NVOCMP_INDEXINVALID;
+#endif
+
 #if(NVOCMP_NVPAGES == NVOCMP_NVONEP)
   srcPg = 0;
   dstPg = 0;
@@ -4373,6 +5111,40 @@ static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
 }
 #endif
 
+/******************************************************************************
+ * @fn      NVOCMP_compactPage
+ *
+ * @brief   Compact NV, see NVOCMP_doCompactPage(). Counts the compaction
+ *          and its duration when NVOCMP_WEAR_STATS is defined.
+ *
+ * @param   pNvHandle - pointer to NV handle
+ * @param   nBytes - size of item to write if any
+ *
+ * @return  Number of available bytes on compacted page, -1 if error
+ */
+static int16_t NVOCMP_compactPage(NVOCMP_nvHandle_t *pNvHandle, uint16_t nBytes)
+{
+#if defined(NVOCMP_WEAR_STATS) && !defined(NV_LINUX)
+  uint32_t start = ClockP_getSystemTicks();
+  int16_t ret = NVOCMP_doCompactPage(pNvHandle, nBytes);
+  uint32_t ms = ((ClockP_getSystemTicks() - start) * ClockP_getSystemTickPeriod()) / 1000;
+
+  NVOCMP_wearStats.compactions++;
+  NVOCMP_wearStats.compactTimeLast = ms;
+  NVOCMP_wearStats.compactTimeTotal += ms;
+  if(ms > NVOCMP_wearStats.compactTimeMax)
+  {
+    NVOCMP_wearStats.compactTimeMax = ms;
+  }
+  return(ret);
+#else
+#ifdef NVOCMP_WEAR_STATS
+  NVOCMP_wearStats.compactions++;
+#endif
+  return(NVOCMP_doCompactPage(pNvHandle, nBytes));
+#endif
+}
+
 /******************************************************************************
 * @fn      NVOCMP_findSignature
 *
@@ -4948,7 +5720,9 @@ static void NVOCMP_writeByte(uint8_t pg, uint16_t ofs, uint8_t bwv)
  * @fn      NVOCMP_doNVCRC
  *
  * @brief   Computes the CRC8 on the NV buffer indicated
- *          CRC code external, API in crc.h
+ *          CRC code external, API in crc.h. Memory mapped flash and
+ *          the compaction buffer are read in place, other flash is read
+ *          in NVOCMP_XFERBLKMAX blocks.
  *
  * @param   pg - Flash page to check
  * @param   ofs - Flash page offset to lowest address item byte
@@ -4971,22 +5745,29 @@ static uint8_t NVOCMP_doNVCRC(uint8_t pg, uint16_t ofs, uint16_t len, uint8_t cr
     uint8_t tmp[NVOCMP_XFERBLKMAX];
     crc_t newCRC = (crc_t)crc;
 
+#ifndef NVOCMP_RAM_OPTIMIZATION
+    if(flag)
+    {
+        // Compaction buffer is in RAM, no need to copy
+        return((uint8_t)crc_update(newCRC, pTBuffer + ofs, len));
+    }
+#endif
+#ifndef NV_LINUX
+    if(NVOCMP_nvsAttrs.regionBase != NULL &&
+       NVOCMP_nvsAttrs.regionBase != NVS_REGION_NOT_ADDRESSABLE)
+    {
+        // Internal flash is memory mapped, compute CRC in place
+        return((uint8_t)crc_update(newCRC,
+                                   (uint8_t *)NVOCMP_nvsAttrs.regionBase + NVOCMP_FLASHOFFSET(pg, ofs),
+                                   len));
+    }
+#endif
+
     // Read flash and compute CRC in blocks
     while(len > 0)
     {
         rdLen  = (len < NVOCMP_XFERBLKMAX ? len : NVOCMP_XFERBLKMAX);
-#ifndef NVOCMP_RAM_OPTIMIZATION
-        if(flag)
-        {
-          memcpy((uint8_t *)tmp, (uint8_t *)(pTBuffer+ofs), rdLen);
-        }
-        else
-        {
-#endif
-          NVOCMP_read(pg, ofs, tmp, rdLen);
-#ifndef NVOCMP_RAM_OPTIMIZATION
-        }
-#endif
+        NVOCMP_read(pg, ofs, tmp, rdLen);
         newCRC = crc_update(newCRC,tmp,rdLen);
         len   -= rdLen;
         ofs   += rdLen;
@@ -64,6 +64,12 @@ extern "C"
 // NV driver item ID definitions
 #define NVOCMP_NVID_DIAG {NVINTF_SYSID_NVDRVR, 1, 0}
 
+// Maximum ID parameters - must be coordinated with header format
+#define NVOCMP_MAXSYSID     0x003F  //  6 bits
+#define NVOCMP_MAXITEMID    0x03FF  // 10 bits
+#define NVOCMP_MAXSUBID     0x03FF  // 10 bits
+#define NVOCMP_MAXLEN       0x0FFF  // 12 bits
+
 //*****************************************************************************
 // Typedefs
 //*****************************************************************************
@@ -80,8 +86,48 @@ typedef struct
 }
 NVOCMP_diag_t;
 
+// One item of a NVOCMP_readBatch() or NVOCMP_writeBatch() call. Not part of
+// NVINTF_nvFuncts_t: that table is allocated by code built with the SDK's
+// nvintf.h and must keep its size.
+typedef struct
+{
+    NVINTF_itemID_t id;     // User inputs item ID
+    uint16_t len;           // User inputs bytes to read or write
+    void *   buffer;        // Item contents read from or written to here
+    uint8_t  status;        // API returns the status of this item
+}
+NVOCMP_batchItem_t;
+
 // Low Voltage Check Callback function, voltage is measured voltage value
 typedef void (*lowVoltCbFptr)(uint32_t voltage);
+
+// Largest supported NVOCMP_NVPAGES
+#define NVOCMP_MAX_NVPAGES  5
+
+#ifdef NVOCMP_WEAR_STATS
+// Page erase endurance of the device flash, see the datasheet
+#ifndef NVOCMP_FLASH_ENDURANCE
+#define NVOCMP_FLASH_ENDURANCE  10000
+#endif
+
+// NV wear figures, counters are since reset
+typedef struct
+{
+    uint8_t  nvPages;       // Number of NV pages in use
+    uint8_t  cycle[NVOCMP_MAX_NVPAGES]; // Page header cycle count, bumped on
+                            // each erase of the page (1..254, then rolls over)
+    uint32_t liveBytes;     // Active items, headers included
+    uint32_t deadBytes;     // Inactive items, freed by the next compaction
+    uint32_t freeBytes;     // Left before a compaction is needed
+    uint32_t erases;        // Number of page erases
+    uint32_t compactions;   // Number of compactions
+    uint32_t compactTimeLast;   // Duration of the last compaction (ms)
+    uint32_t compactTimeMax;    // Longest compaction (ms)
+    uint32_t compactTimeTotal;  // All compactions (ms)
+}
+NVOCMP_wearStats_t;
+#endif
+
 //*****************************************************************************
 // Functions
 //*****************************************************************************
@@ -154,6 +200,47 @@ extern void NVOCMP_setCheckVoltage(void *funcPtr);
  */
 extern void NVOCMP_setLowVoltageCb(lowVoltCbFptr funcPtr);
 
+/**
+ * @fn      NVOCMP_readBatch
+ *
+ * @brief   Global function to read several NV items with one lock and one
+ *          pass over NV. Each item is read like readItem(id, 0, len, buffer).
+ *
+ * @param   pItems - items to read, status is set for each of them
+ * @param   count - number of items
+ *
+ * @return  NVINTF_SUCCESS or the status of the first item which failed
+ */
+extern uint8_t NVOCMP_readBatch(NVOCMP_batchItem_t *pItems, uint16_t count);
+
+/**
+ * @fn      NVOCMP_writeBatch
+ *
+ * @brief   Global function to write several NV items under one lock. Each
+ *          item is written like writeItem(id, len, buffer).
+ *
+ * @param   pItems - items to write, status is set for each of them
+ * @param   count - number of items
+ *
+ * @return  NVINTF_SUCCESS or the status of the first item which failed
+ */
+extern uint8_t NVOCMP_writeBatch(NVOCMP_batchItem_t *pItems, uint16_t count);
+
+#ifdef NVOCMP_WEAR_STATS
+/**
+ * @fn      NVOCMP_getWearStats
+ *
+ * @brief   Global function to read the NV wear figures. Live and dead
+ *          bytes are counted by walking the items, so this takes about
+ *          as long as a search for an item which does not exist.
+ *
+ * @param   pStats - pointer to caller's buffer
+ *
+ * @return  NVINTF_SUCCESS or NVINTF_BADPARAM
+ */
+extern uint8_t NVOCMP_getWearStats(NVOCMP_wearStats_t *pStats);
+#endif
+
 // Exception function can be defined to handle NV corruption issues
 // If none provided, NV module attempts to proceed ignoring problem
 #if !defined (NVOCMP_EXCEPTION)
@@ -10,6 +10,7 @@
  */
 
 #include <FreeRTOS.h>
+#include <task.h>
 #include <icall.h>
 /* POSIX Header files */
 #include <pthread.h>
@@ -20,6 +21,8 @@
 #include <common/Services/data_stream/data_stream_server.h>
 #include <trans_uartApi.h>
 #include <common/FreeRTOSCli/cli_api.h>
+#include <common/Drivers/NV/nv_log.h>
+#include <app_main.h>
 /* Driver configuration */
 #include "ti_drivers_config.h"
 #include "icall_ble_api.h"
@@ -43,6 +46,9 @@ static UART2_Handle trans_uartHandle = NULL;
 static UART2_Params trans_uartParams;
 ICall_EntityID trans_UartICallEntityID;
 static uint8_t trans_mode_on_off = TRANS_MODE_OFF;
+static uint32_t trans_bytesToBle = 0;      // this session, logged when it ends
+static uint32_t trans_bytesToUart = 0;
+static TickType_t trans_startTick = 0;
 
 /* === Functions === */
 static bStatus_t trans_bleTransferUart(void);
@@ -83,6 +89,10 @@ bStatus_t trans_uartEnable(void)
     if (trans_uartHandle == NULL)
     { while (1) {} /* UART2_open() failed */ }
 
+    trans_bytesToBle = 0;
+    trans_bytesToUart = 0;
+    trans_startTick = xTaskGetTickCount();
+
     return status;
 }
 
@@ -100,6 +110,14 @@ bStatus_t trans_uartDisable(void)
 bStatus_t trans_switchBackToCli(void)
 {
     bStatus_t status = SUCCESS;
+    uint32_t sample[3];
+
+    // Throughput of the session, see AT+LOGDUMP
+    sample[0] = trans_bytesToBle;
+    sample[1] = trans_bytesToUart;
+    sample[2] = (uint32_t)(xTaskGetTickCount() - trans_startTick) * portTICK_PERIOD_MS;
+    NvTask_log(NV_LOG_THROUGHPUT, sample, sizeof(sample));
+
     status |= UART2_write(trans_uartHandle, pcBackCliMessage, strlen( pcBackCliMessage ), NULL);
     status |= trans_uartDisable();
     status |= cli_uartEnable();
@@ -133,6 +151,8 @@ static bStatus_t trans_bleTransferUart(void)
 
         if(bleStatus != SUCCESS)
         { /* DSS_setParameter() failed */ while (1) {} }
+
+        trans_bytesToBle += numBytesRead;
     }
     return status;
 }
@@ -202,7 +222,11 @@ void trans_uartStart(void)
 
 int_fast16_t trans_uartTxSend(uint8_t *pValue, uint16_t len)
 {
-    return UART2_write(trans_uartHandle, pValue, len, NULL);
+    int_fast16_t status = UART2_write(trans_uartHandle, pValue, len, NULL);
+
+    if (status == UART2_STATUS_SUCCESS)
+    { trans_bytesToUart += len; }
+    return status;
 }
 
 UART2_Handle trans_getUartHandle(void)
@@ -49,11 +49,15 @@ one of the application files:
 	#define configAPPLICATION_PROVIDES_cOutputBuffer 0
 #endif
 
-typedef struct xCOMMAND_INPUT_LIST
-{
-	const CLI_Command_Definition_t *pxCommandLineDefinition;
-	struct xCOMMAND_INPUT_LIST *pxNext;
-} CLI_Definition_List_Item_t;
+/* Maximum number of commands, including "HELP".  Commands are kept in a
+static table instead of a heap allocated list. */
+#ifndef configCOMMAND_INT_MAX_COMMANDS
+	#define configCOMMAND_INT_MAX_COMMANDS 40
+#endif
+
+#if( configCOMMAND_INT_MAX_COMMANDS > 255 )
+	#error configCOMMAND_INT_MAX_COMMANDS must fit in the uint8_t sorted index
+#endif
 
 /*
  * The callback function that is executed when "help" is entered.  This is the
@@ -66,6 +70,17 @@ static BaseType_t prvHelpCommand( char *pcWriteBuffer, size_t xWriteBufferLen, c
  */
 static int8_t prvGetNumberOfParameters( const char *pcCommandString );
 
+/*
+ * Compare the first xWordLength characters of a command line with a command
+ * name, in the same order as strcmp().
+ */
+static int prvCompareCommand( const char *pcWord, size_t xWordLength, const char *pcCommand );
+
+/*
+ * Binary search of the sorted index.  Returns NULL if the command is unknown.
+ */
+static const CLI_Command_Definition_t *prvFindCommand( const char *pcCommandInput );
+
 /* The definition of the "help" command.  This command is always at the front
 of the list of registered commands. */
 static const CLI_Command_Definition_t xHelpCommand =
@@ -73,16 +88,26 @@ static const CLI_Command_Definition_t xHelpCommand =
 	"HELP",
 	"",
 	prvHelpCommand,
+	0,
 	0
 };
 
-/* The definition of the list of commands.  Commands that are registered are
-added to this list. */
-static CLI_Definition_List_Item_t xRegisteredCommands =
+/* The table of registered commands, in registration order, which is the order
+"HELP" lists them in.  The first command is always the help command, defined
+in this file. */
+static const CLI_Command_Definition_t *pxRegisteredCommands[ configCOMMAND_INT_MAX_COMMANDS ] =
 {
-	&xHelpCommand,	/* The first command in the list is always the help command, defined in this file. */
-	NULL			/* The next pointer is initialised to NULL, as there are no other registered commands yet. */
+	&xHelpCommand
 };
+static UBaseType_t uxRegisteredCommandCount = 1;
+
+/* Set when the last command line was not run: unknown command or wrong number
+of parameters. */
+static BaseType_t xInputRejected = pdFALSE;
+
+/* Indexes into pxRegisteredCommands, sorted by command name, so a command line
+is matched with a binary search. */
+static uint8_t ucSortedCommands[ configCOMMAND_INT_MAX_COMMANDS ] = { 0 };
 
 /* A buffer into which command outputs can be written is declared here, rather
 than in the command console implementation, to allow multiple command consoles
@@ -107,35 +132,37 @@ buffer needs to be placed at a fixed address (rather than by the linker). */
 
 BaseType_t FreeRTOS_CLIRegisterCommand( const CLI_Command_Definition_t * const pxCommandToRegister )
 {
-static CLI_Definition_List_Item_t *pxLastCommandInList = &xRegisteredCommands;
-CLI_Definition_List_Item_t *pxNewListItem;
 BaseType_t xReturn = pdFAIL;
+UBaseType_t uxPosition;
+const char *pcCommand;
 
 	/* Check the parameter is not NULL. */
 	configASSERT( pxCommandToRegister );
 
-	/* Create a new list item that will reference the command being registered. */
-	pxNewListItem = ( CLI_Definition_List_Item_t * ) pvPortMalloc( sizeof( CLI_Definition_List_Item_t ) );
-	configASSERT( pxNewListItem );
+	/* Check there is room left in the table. */
+	configASSERT( uxRegisteredCommandCount < configCOMMAND_INT_MAX_COMMANDS );
 
-	if( pxNewListItem != NULL )
+	if( uxRegisteredCommandCount < configCOMMAND_INT_MAX_COMMANDS )
 	{
+		pcCommand = pxCommandToRegister->pcCommand;
+
 		taskENTER_CRITICAL();
 		{
-			/* Reference the command being registered from the newly created
-			list item. */
-			pxNewListItem->pxCommandLineDefinition = pxCommandToRegister;
-
-			/* The new list item will get added to the end of the list, so
-			pxNext has nowhere to point. */
-			pxNewListItem->pxNext = NULL;
-
-			/* Add the newly created list item to the end of the already existing
-			list. */
-			pxLastCommandInList->pxNext = pxNewListItem;
+			/* Add the command to the end of the table. */
+			pxRegisteredCommands[ uxRegisteredCommandCount ] = pxCommandToRegister;
+
+			/* Insert it in the sorted index, shifting the larger names up.
+			This only runs at boot, for a few tens of commands. */
+			uxPosition = uxRegisteredCommandCount;
+			while( ( uxPosition > 0 ) &&
+				   ( strcmp( pxRegisteredCommands[ ucSortedCommands[ uxPosition - 1 ] ]->pcCommand, pcCommand ) > 0 ) )
+			{
+				ucSortedCommands[ uxPosition ] = ucSortedCommands[ uxPosition - 1 ];
+				uxPosition--;
+			}
+			ucSortedCommands[ uxPosition ] = ( uint8_t ) uxRegisteredCommandCount;
 
-			/* Set the end of list marker to the new list item. */
-			pxLastCommandInList = pxNewListItem;
+			uxRegisteredCommandCount++;
 		}
 		taskEXIT_CRITICAL();
 
@@ -148,44 +175,26 @@ BaseType_t xReturn = pdFAIL;
 
 BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput, char * pcWriteBuffer, size_t xWriteBufferLen  )
 {
-static const CLI_Definition_List_Item_t *pxCommand = NULL;
+static const CLI_Command_Definition_t *pxCommand = NULL;
 BaseType_t xReturn = pdTRUE;
-const char *pcRegisteredCommandString;
-size_t xCommandStringLength;
 
 	/* Note:  This function is not re-entrant.  It must not be called from more
 	thank one task. */
 
 	if( pxCommand == NULL )
 	{
-		/* Search for the command string in the list of registered commands. */
-		for( pxCommand = &xRegisteredCommands; pxCommand != NULL; pxCommand = pxCommand->pxNext )
+		/* Search for the command string in the sorted index. */
+		pxCommand = prvFindCommand( pcCommandInput );
+		xInputRejected = pdFALSE;
+
+		/* The command has been found.  Check it has the expected number of
+		parameters.  If cExpectedNumberOfParameters is -1, then there could be
+		a variable number of parameters and no check is made. */
+		if( ( pxCommand != NULL ) && ( pxCommand->cExpectedNumberOfParameters >= 0 ) )
 		{
-			pcRegisteredCommandString = pxCommand->pxCommandLineDefinition->pcCommand;
-			xCommandStringLength = strlen( pcRegisteredCommandString );
-
-			/* To ensure the string lengths match exactly, so as not to pick up
-			a sub-string of a longer command, check the byte after the expected
-			end of the string is either the end of the string or a space before
-			a parameter. */
-			if( strncmp( pcCommandInput, pcRegisteredCommandString, xCommandStringLength ) == 0 )
+			if( prvGetNumberOfParameters( pcCommandInput ) != pxCommand->cExpectedNumberOfParameters )
 			{
-				if( ( pcCommandInput[ xCommandStringLength ] == ' ' ) || ( pcCommandInput[ xCommandStringLength ] == 0x00 ) )
-				{
-					/* The command has been found.  Check it has the expected
-					number of parameters.  If cExpectedNumberOfParameters is -1,
-					then there could be a variable number of parameters and no
-					check is made. */
-					if( pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters >= 0 )
-					{
-						if( prvGetNumberOfParameters( pcCommandInput ) != pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters )
-						{
-							xReturn = pdFALSE;
-						}
-					}
-
-					break;
-				}
+				xReturn = pdFALSE;
 			}
 		}
 	}
@@ -193,14 +202,16 @@ size_t xCommandStringLength;
 	if( ( pxCommand != NULL ) && ( xReturn == pdFALSE ) )
 	{
 		/* The command was found, but the number of parameters with the command
-		was incorrect. FIXME: should return ERROR instead. */
+		was incorrect.  The caller reports it as an error, see
+		FreeRTOS_CLIInputRejected(). */
 		strncpy( pcWriteBuffer, "\r\nIncorrect command parameter(s).  Enter \"HELP\" to view a list of available commands.\r\n", xWriteBufferLen );
 		pxCommand = NULL;
+		xInputRejected = pdTRUE;
 	}
 	else if( pxCommand != NULL )
 	{
 		/* Call the callback function that is registered to this command. */
-		xReturn = pxCommand->pxCommandLineDefinition->pxCommandInterpreter( pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+		xReturn = pxCommand->pxCommandInterpreter( pcWriteBuffer, xWriteBufferLen, pcCommandInput );
 
 		/* If xReturn is pdFALSE, then no further strings will be returned
 		after this one, and	pxCommand can be reset to NULL ready to search
@@ -212,8 +223,9 @@ size_t xCommandStringLength;
 	}
 	else
 	{
-		/* pxCommand was NULL, the command was not found. FIXME: should return ERROR instead. */
+		/* pxCommand was NULL, the command was not found. */
 		strncpy( pcWriteBuffer, "\r\nCommand not recognized.  Enter \"HELP\" to view a list of available commands.\r\n", xWriteBufferLen );
+		xInputRejected = pdTRUE;
 		xReturn = pdFALSE;
 	}
 
@@ -221,6 +233,33 @@ size_t xCommandStringLength;
 }
 /*-----------------------------------------------------------*/
 
+BaseType_t FreeRTOS_CLIInputRejected( void )
+{
+	return xInputRejected;
+}
+/*-----------------------------------------------------------*/
+
+const CLI_Command_Definition_t *FreeRTOS_CLIFindOpcode( uint8_t ucOpcode )
+{
+UBaseType_t uxCommand;
+
+	/* Opcode 0 marks the commands that are not available over the binary
+	protocol. */
+	if( ucOpcode != 0 )
+	{
+		for( uxCommand = 0; uxCommand < uxRegisteredCommandCount; uxCommand++ )
+		{
+			if( pxRegisteredCommands[ uxCommand ]->ucOpcode == ucOpcode )
+			{
+				return pxRegisteredCommands[ uxCommand ];
+			}
+		}
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
 char *FreeRTOS_CLIGetOutputBuffer( void )
 {
 	return cOutputBuffer;
@@ -285,26 +324,21 @@ const char *pcReturn = NULL;
 
 static BaseType_t prvHelpCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
-static const CLI_Definition_List_Item_t * pxCommand = NULL;
+static UBaseType_t uxCommand = 0;
 BaseType_t xReturn;
 
 	( void ) pcCommandString;
 
-	if( pxCommand == NULL )
-	{
-		/* Reset the pxCommand pointer back to the start of the list. */
-		pxCommand = &xRegisteredCommands;
-	}
-
-	/* Return the next command help string, before moving the pointer on to
-	the next command in the list. */
-	strncpy( pcWriteBuffer, pxCommand->pxCommandLineDefinition->pcHelpString, xWriteBufferLen );
-	pxCommand = pxCommand->pxNext;
+	/* Return the next command help string, in registration order, before
+	moving on to the next command in the table. */
+	strncpy( pcWriteBuffer, pxRegisteredCommands[ uxCommand ]->pcHelpString, xWriteBufferLen );
+	uxCommand++;
 
-	if( pxCommand == NULL )
+	if( uxCommand >= uxRegisteredCommandCount )
 	{
-		/* There are no more commands in the list, so there will be no more
+		/* There are no more commands in the table, so there will be no more
 		strings to return after this one and pdFALSE should be returned. */
+		uxCommand = 0;
 		xReturn = pdFALSE;
 	}
 	else
@@ -316,6 +350,61 @@ BaseType_t xReturn;
 }
 /*-----------------------------------------------------------*/
 
+static int prvCompareCommand( const char *pcWord, size_t xWordLength, const char *pcCommand )
+{
+int iResult;
+
+	iResult = strncmp( pcWord, pcCommand, xWordLength );
+
+	/* The first xWordLength characters match, the command is only equal if it
+	is not longer than the word. */
+	if( ( iResult == 0 ) && ( pcCommand[ xWordLength ] != 0x00 ) )
+	{
+		iResult = -1;
+	}
+
+	return iResult;
+}
+/*-----------------------------------------------------------*/
+
+static const CLI_Command_Definition_t *prvFindCommand( const char *pcCommandInput )
+{
+size_t xWordLength = 0;
+UBaseType_t uxLow = 0, uxHigh = uxRegisteredCommandCount, uxMid;
+const CLI_Command_Definition_t *pxCommand;
+int iResult;
+
+	/* The command name is the first word, ended by a space or the end of the
+	string, so a sub-string of a longer command is never matched. */
+	while( ( pcCommandInput[ xWordLength ] != 0x00 ) && ( pcCommandInput[ xWordLength ] != ' ' ) )
+	{
+		xWordLength++;
+	}
+
+	while( uxLow < uxHigh )
+	{
+		uxMid = ( uxLow + uxHigh ) / 2;
+		pxCommand = pxRegisteredCommands[ ucSortedCommands[ uxMid ] ];
+		iResult = prvCompareCommand( pcCommandInput, xWordLength, pxCommand->pcCommand );
+
+		if( iResult == 0 )
+		{
+			return pxCommand;
+		}
+		else if( iResult < 0 )
+		{
+			uxHigh = uxMid;
+		}
+		else
+		{
+			uxLow = uxMid + 1;
+		}
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
 static int8_t prvGetNumberOfParameters( const char *pcCommandString )
 {
 int8_t cParameters = 0;
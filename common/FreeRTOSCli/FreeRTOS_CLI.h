@@ -48,6 +48,7 @@ typedef struct xCOMMAND_LINE_INPUT
 	const char * const pcHelpString;			/* String that describes how to use the command.  Should start with the command itself, and end with "\r\n".  For example "help: Returns a list of all the commands\r\n". */
 	const pdCOMMAND_LINE_CALLBACK pxCommandInterpreter;	/* A pointer to the callback function that will return the output generated by the command. */
 	int8_t cExpectedNumberOfParameters;			/* Commands expect a fixed number of parameters, which may be zero. */
+	const uint8_t ucOpcode;						/* Opcode of the command in the binary protocol (cli_binary.c), 0 if not available. */
 } CLI_Command_Definition_t;
 
 /* For backward compatibility. */
@@ -74,6 +75,19 @@ BaseType_t FreeRTOS_CLIRegisterCommand( const CLI_Command_Definition_t * const p
  */
 BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput, char * pcWriteBuffer, size_t xWriteBufferLen  );
 
+/*
+ * Returns pdTRUE if the command line last passed to FreeRTOS_CLIProcessCommand
+ * was not run, because the command is unknown or has the wrong number of
+ * parameters.  The output buffer then holds a message instead of the output
+ * of a command.
+ */
+BaseType_t FreeRTOS_CLIInputRejected( void );
+
+/*
+ * Return the registered command with the given binary protocol opcode, or NULL.
+ */
+const CLI_Command_Definition_t *FreeRTOS_CLIFindOpcode( uint8_t ucOpcode );
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -16,6 +16,44 @@
 #define CLI_SWITCH_TRANS_ON     true
 #define CLI_SWITCH_TRANS_OFF    false
 
+/* URC types, see cli_urcSetMask() */
+#define CLI_URC_CONN            (0x01)  // +CONN:<h>,<addr>
+#define CLI_URC_DISC            (0x02)  // +DISC:<h>,<reason>
+#define CLI_URC_MTU             (0x04)  // +MTU:<h>,<mtu>
+#define CLI_URC_PHY             (0x08)  // +PHY:<h>,<txPhy>,<rxPhy>
+#define CLI_URC_CCC             (0x10)  // +CCC:<h>,<value>
+#define CLI_URC_ALL             (0x1F)
+
+/* Binary protocol, see cli_binary.c */
+#define CLI_BIN_OP_URC          0x7E    // unsolicited, "+CONN:..." without "\r\n"
+#define CLI_BIN_OP_EXIT         0x7F    // back to the text AT interface
+#define CLI_BIN_OP_RSP          0x80    // set in the opcode of responses
+#define CLI_BIN_STATUS_OK       0x00
+#define CLI_BIN_STATUS_ERROR    0x01
+#define CLI_BIN_STATUS_UNKNOWN  0x02    // unknown opcode
+#define CLI_BIN_STATUS_BAD_PARAM 0x03
+#define CLI_BIN_STATUS_BUSY     0x04    // command queue full
+#define CLI_BIN_STATUS_TOO_LONG 0x05    // output does not fit in one response
+
+/* AT command scripts, see cli_script.c */
+#define CLI_SCRIPT_NAME_LEN     8
+#define CLI_SCRIPT_MAX_LENGTH   240     // lines and ';' separators
+
+/* Command results, see cli_uartCmdSetResult() */
+#define CLI_RESULT_NONE         0
+#define CLI_RESULT_OK           1
+#define CLI_RESULT_ERROR        2
+
+/* Output writer over a handler's pcWriteBuffer, see cli_output.c */
+typedef struct
+{
+    char    *pBuf;
+    size_t  size;
+    size_t  len;        // bytes in pBuf, not counting the terminator
+    size_t  total;      // bytes appended, including the flushed ones
+    uint8   truncated;  // a formatted piece did not fit in the buffer
+} cli_output_t;
+
 /**
  * Setup command list table
  */
@@ -26,5 +64,52 @@ bStatus_t cli_uartEnable(void);
 bStatus_t cli_uartDisable(void);
 int cli_resumeByPostSemaphore(void);
 void cli_setTransModeSwitchFlag(uint8 onOff);
+bStatus_t cli_uartPrint(const char *pStr, size_t len);
+int cli_execResumeByPostSemaphore(void);
+void cli_uartCmdOutput(const char *pStr, size_t len);
+const char *cli_uartCmdSetResult(uint8 result);
+uint8 cli_uartCmdRunLine(char *pcInputString);
+uint32_t cli_uartGetRxDropped(void);
+
+/**
+ * Command output writer
+ */
+void cli_outInit(cli_output_t *pOut, char *pBuf, size_t size);
+void cli_outAppend(cli_output_t *pOut, const char *pStr, size_t len);
+void cli_outAppendf(cli_output_t *pOut, const char *fmt, ...);
+void cli_outFlush(cli_output_t *pOut);
+void cli_outResult(cli_output_t *pOut, uint8 result);
+
+/**
+ * AT command scripts
+ */
+bStatus_t cli_scriptStore(const char *pName, size_t nameLen, const char *pText, size_t textLen);
+bStatus_t cli_scriptDelete(const char *pName, size_t nameLen);
+void cli_scriptList(cli_output_t *pOut);
+bStatus_t cli_scriptRequest(const char *pName, size_t nameLen);
+void cli_scriptRunPending(void);
+
+/**
+ * Unsolicited result codes
+ */
+bStatus_t cli_urcPost(uint8 type, const char *fmt, ...);
+bStatus_t cli_urcPostRecord(const char *pRec, size_t len);
+size_t cli_urcRecordSpace(void);
+void cli_urcFlush(void);
+void cli_urcSetMask(uint8 mask);
+uint8 cli_urcGetMask(void);
+uint32_t cli_urcGetDropped(void);
+
+/**
+ * Binary host-control protocol
+ */
+void cli_setBinaryMode(uint8 onOff);
+uint8 cli_getBinaryMode(void);
+uint8 cli_uartBinModeQueued(void);
+void cli_binRxReset(void);
+uint8 cli_binRxByte(uint8_t c);
+uint8 cli_binFrameToCommand(char *pcLine, size_t xLineLen, uint8_t *pOpcode, uint8_t *pSeq);
+bStatus_t cli_binWriteResponse(uint8_t opcode, uint8_t seq, uint8_t status,
+                               const char *pOutput, size_t outputLen);
 
 #endif /* COMMON_FREERTOSCLI_CLI_API_H_ */
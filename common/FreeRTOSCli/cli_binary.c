@@ -0,0 +1,273 @@
+/******************************************************************************
+
+@file  cli_binary.c
+
+@brief Binary host-control framing for the AT command table.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * Frame:    SOF(0xA5) | len(2, LE) | opcode | seq | payload | crc8
+ *           len counts opcode, seq and payload. crc8 (crc.h) covers len to
+ *           the end of the payload.
+ * Request:  payload is a list of TLV parameters, type | len | value
+ *             CLI_BIN_TLV_INT : 1, 2 or 4 byte little endian signed integer
+ *             CLI_BIN_TLV_STR : characters, no space
+ * Response: opcode | 0x80, same seq, payload is status | [CLI_BIN_TLV_STR
+ *           with the text output of the command, in one or more TLVs].
+ *           Output over CLI_BIN_MAX_RSP_OUTPUT is not cut, the status is
+ *           CLI_BIN_STATUS_TOO_LONG without output.
+ *
+ * Every opcode maps to an entry of the AT command table (ucOpcode), and the
+ * parameters are handed to the same handler as the text command, so each
+ * operation is implemented once.
+ */
+
+#include <FreeRTOS.h>
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS_CLI.h"
+#include "icall_ble_api.h"
+#include <common/FreeRTOSCli/cli_api.h>
+#include <common/Drivers/NV/crc.h>
+
+#define CLI_BIN_SOF             0xA5
+#define CLI_BIN_HDR_LEN         3       // SOF + len
+#define CLI_BIN_MAX_LEN         256     // opcode + seq + payload
+#define CLI_BIN_MAX_RSP_OUTPUT  512
+
+#define CLI_BIN_TLV_INT         0x01
+#define CLI_BIN_TLV_STR         0x02
+
+typedef enum
+{
+    CLI_BIN_WAIT_SOF,
+    CLI_BIN_WAIT_LEN_L,
+    CLI_BIN_WAIT_LEN_H,
+    CLI_BIN_WAIT_BODY,
+    CLI_BIN_WAIT_CRC
+} cli_binRxState_e;
+
+/* === Local Variables ===*/
+static uint8 binMode = FALSE;
+static cli_binRxState_e binRxState = CLI_BIN_WAIT_SOF;
+static uint8_t binRxLenBytes[2];
+static uint16_t binRxLen;
+static uint16_t binRxIndex;
+static uint8_t binRxFrame[CLI_BIN_MAX_LEN];
+static uint32_t binRxBadFrames = 0;
+static uint8_t binTxFrame[CLI_BIN_HDR_LEN + 3 + CLI_BIN_MAX_RSP_OUTPUT +
+                          2 * (CLI_BIN_MAX_RSP_OUTPUT / 255 + 1) + 1];
+
+/* Framing of the output (answers and URCs), set by the executor thread */
+void cli_setBinaryMode(uint8 onOff)
+{
+    binMode = onOff;
+}
+
+/* Console thread: start looking for a SOF, when the input switches to frames */
+void cli_binRxReset(void)
+{
+    binRxState = CLI_BIN_WAIT_SOF;
+}
+
+uint8 cli_getBinaryMode(void)
+{
+    return binMode;
+}
+
+/*
+ * Feed one received byte to the frame parser. Returns TRUE when a complete
+ * frame with a valid crc is available, see cli_binFrameToCommand().
+ */
+uint8 cli_binRxByte(uint8_t c)
+{
+    crc_t crc;
+
+    switch (binRxState)
+    {
+    case CLI_BIN_WAIT_SOF:
+        if (c == CLI_BIN_SOF)
+        { binRxState = CLI_BIN_WAIT_LEN_L; }
+        break;
+    case CLI_BIN_WAIT_LEN_L:
+        binRxLenBytes[0] = c;
+        binRxState = CLI_BIN_WAIT_LEN_H;
+        break;
+    case CLI_BIN_WAIT_LEN_H:
+        binRxLenBytes[1] = c;
+        binRxLen = BUILD_UINT16(binRxLenBytes[0], binRxLenBytes[1]);
+        binRxIndex = 0;
+        if (binRxLen < 2 || binRxLen > CLI_BIN_MAX_LEN)
+        {
+            // resync on the next SOF
+            binRxBadFrames++;
+            binRxState = CLI_BIN_WAIT_SOF;
+        }
+        else
+        { binRxState = CLI_BIN_WAIT_BODY; }
+        break;
+    case CLI_BIN_WAIT_BODY:
+        binRxFrame[binRxIndex++] = c;
+        if (binRxIndex == binRxLen)
+        { binRxState = CLI_BIN_WAIT_CRC; }
+        break;
+    case CLI_BIN_WAIT_CRC:
+        binRxState = CLI_BIN_WAIT_SOF;
+        crc = crc_init();
+        crc = crc_update(crc, binRxLenBytes, 2);
+        crc = crc_update(crc, binRxFrame, binRxLen);
+        if (crc_finalize(crc) == c)
+        { return TRUE; }
+        binRxBadFrames++;
+        break;
+    default:
+        binRxState = CLI_BIN_WAIT_SOF;
+        break;
+    }
+
+    return FALSE;
+}
+
+/*
+ * Turn the last received frame into an AT command line for the interpreter.
+ * Returns CLI_BIN_STATUS_OK, or the status to answer the frame with.
+ */
+uint8 cli_binFrameToCommand(char *pcLine, size_t xLineLen, uint8_t *pOpcode, uint8_t *pSeq)
+{
+    const CLI_Command_Definition_t *pxCommand;
+    uint16_t i = 2;
+    size_t len;
+
+    *pOpcode = binRxFrame[0];
+    *pSeq = binRxFrame[1];
+
+    if (pcLine == NULL)
+    { return CLI_BIN_STATUS_OK; } // header only
+
+    if (*pOpcode == CLI_BIN_OP_EXIT)
+    {
+        pcLine[0] = '\0';
+        return CLI_BIN_STATUS_OK;
+    }
+
+    pxCommand = FreeRTOS_CLIFindOpcode(*pOpcode);
+    if (pxCommand == NULL)
+    { return CLI_BIN_STATUS_UNKNOWN; }
+
+    len = strlen(pxCommand->pcCommand);
+    if (len >= xLineLen)
+    { return CLI_BIN_STATUS_BAD_PARAM; }
+    memcpy(pcLine, pxCommand->pcCommand, len);
+
+    while (i < binRxLen)
+    {
+        uint8_t type, tlvLen;
+        uint8_t *pValue;
+
+        if (i + 2 > binRxLen)
+        { return CLI_BIN_STATUS_BAD_PARAM; }
+        type = binRxFrame[i];
+        tlvLen = binRxFrame[i + 1];
+        pValue = &binRxFrame[i + 2];
+        if (i + 2 + tlvLen > binRxLen)
+        { return CLI_BIN_STATUS_BAD_PARAM; }
+
+        if (type == CLI_BIN_TLV_INT)
+        {
+            char num[12];
+            int32_t value;
+            int numLen;
+
+            if (tlvLen == 1)
+            { value = (int8_t)pValue[0]; }
+            else if (tlvLen == 2)
+            { value = (int16_t)BUILD_UINT16(pValue[0], pValue[1]); }
+            else if (tlvLen == 4)
+            { value = (int32_t)BUILD_UINT32(pValue[0], pValue[1], pValue[2], pValue[3]); }
+            else
+            { return CLI_BIN_STATUS_BAD_PARAM; }
+
+            numLen = sprintf(num, " %ld", (long)value);
+            if (len + numLen >= xLineLen)
+            { return CLI_BIN_STATUS_BAD_PARAM; }
+            memcpy(&pcLine[len], num, numLen);
+            len += numLen;
+        }
+        else if (type == CLI_BIN_TLV_STR)
+        {
+            // The interpreter splits parameters on spaces
+            if (tlvLen == 0 || memchr(pValue, ' ', tlvLen) != NULL ||
+                memchr(pValue, '\0', tlvLen) != NULL ||
+                len + 1 + tlvLen >= xLineLen)
+            { return CLI_BIN_STATUS_BAD_PARAM; }
+            pcLine[len++] = ' ';
+            memcpy(&pcLine[len], pValue, tlvLen);
+            len += tlvLen;
+        }
+        else
+        { return CLI_BIN_STATUS_BAD_PARAM; }
+
+        i += 2 + tlvLen;
+    }
+
+    pcLine[len] = '\0';
+    return CLI_BIN_STATUS_OK;
+}
+
+/*
+ * Send a response frame. The text output is truncated to
+ * CLI_BIN_MAX_RSP_OUTPUT bytes.
+ */
+bStatus_t cli_binWriteResponse(uint8_t opcode, uint8_t seq, uint8_t status,
+                               const char *pOutput, size_t outputLen)
+{
+    uint8_t statusFrame[CLI_BIN_HDR_LEN + 3 + 1];
+    uint8_t *pFrame;
+    uint16_t len = 0;
+    uint16_t bodyLen;
+    crc_t crc;
+
+    if (outputLen > CLI_BIN_MAX_RSP_OUTPUT)
+    { outputLen = CLI_BIN_MAX_RSP_OUTPUT; }
+
+    // Status only responses are also sent from the console thread, keep
+    // them off the shared buffer used by the executor
+    pFrame = (outputLen == 0) ? statusFrame : binTxFrame;
+
+    pFrame[len++] = CLI_BIN_SOF;
+    len += 2;   // length, filled in below
+    pFrame[len++] = opcode | CLI_BIN_OP_RSP;
+    pFrame[len++] = seq;
+    pFrame[len++] = status;
+
+    while (outputLen > 0)
+    {
+        uint8_t chunk = (outputLen > 255) ? 255 : outputLen;
+
+        pFrame[len++] = CLI_BIN_TLV_STR;
+        pFrame[len++] = chunk;
+        memcpy(&pFrame[len], pOutput, chunk);
+        len += chunk;
+        pOutput += chunk;
+        outputLen -= chunk;
+    }
+
+    bodyLen = len - CLI_BIN_HDR_LEN;
+    pFrame[1] = LO_UINT16(bodyLen);
+    pFrame[2] = HI_UINT16(bodyLen);
+
+    crc = crc_init();
+    crc = crc_update(crc, &pFrame[1], len - 1);
+    pFrame[len++] = crc_finalize(crc);
+
+    return cli_uartPrint((const char *)pFrame, len);
+}
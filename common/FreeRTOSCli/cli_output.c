@@ -0,0 +1,136 @@
+/******************************************************************************
+
+@file  cli_output.c
+
+@brief Bounded output writer for command handlers.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * A handler wraps its pcWriteBuffer in a cli_output_t and appends to it.
+ * When the next piece does not fit, the buffer is handed to the console
+ * (cli_uartCmdOutput) and reused, so a response may be longer than
+ * MAX_OUTPUT_LENGTH. Whatever is left in the buffer when the handler
+ * returns goes out through the interpreter as before.
+ * The result goes through cli_outResult(), not as text: tagged, script and
+ * binary commands report it after the output, so it may come first.
+ *
+ *     cli_output_t out;
+ *     cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+ *     cli_outResult(&out, CLI_RESULT_OK);
+ *     cli_outAppendf(&out, "+ITEM:%d\r\n", i);
+ *     return pdFALSE;
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "icall_ble_api.h"
+#include <common/FreeRTOSCli/cli_api.h>
+
+void cli_outInit(cli_output_t *pOut, char *pBuf, size_t size)
+{
+    pOut->pBuf = pBuf;
+    pOut->size = size;
+    pOut->len = 0;
+    pOut->total = 0;
+    pOut->truncated = FALSE;
+    pBuf[0] = '\0';
+}
+
+/* Hand the buffered text to the console, the buffer is empty afterwards */
+void cli_outFlush(cli_output_t *pOut)
+{
+    if (pOut->len == 0)
+    { return; }
+
+    cli_uartCmdOutput(pOut->pBuf, pOut->len);
+    pOut->len = 0;
+    pOut->pBuf[0] = '\0';
+}
+
+/* Record the command result, and append its OK/ERROR unless the caller reports it */
+void cli_outResult(cli_output_t *pOut, uint8 result)
+{
+    const char *pStr = cli_uartCmdSetResult(result);
+
+    cli_outAppend(pOut, pStr, strlen(pStr));
+}
+
+void cli_outAppend(cli_output_t *pOut, const char *pStr, size_t len)
+{
+    size_t chunk;
+
+    pOut->total += len;
+
+    // One byte is kept for the terminator, the interpreter uses strlen()
+    while (len > 0)
+    {
+        if (pOut->len == pOut->size - 1)
+        { cli_outFlush(pOut); }
+
+        chunk = pOut->size - 1 - pOut->len;
+        if (chunk > len)
+        { chunk = len; }
+
+        memcpy(&pOut->pBuf[pOut->len], pStr, chunk);
+        pOut->len += chunk;
+        pStr += chunk;
+        len -= chunk;
+    }
+    pOut->pBuf[pOut->len] = '\0';
+}
+
+void cli_outAppendf(cli_output_t *pOut, const char *fmt, ...)
+{
+    va_list args;
+    size_t room = pOut->size - pOut->len;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(&pOut->pBuf[pOut->len], room, fmt, args);
+    va_end(args);
+    if (len < 0)
+    {
+        pOut->pBuf[pOut->len] = '\0';
+        pOut->truncated = TRUE;
+        return;
+    }
+
+    if ((size_t)len >= room)
+    {
+        // Did not fit, send what is complete and format again
+        pOut->pBuf[pOut->len] = '\0';
+        cli_outFlush(pOut);
+        room = pOut->size;
+
+        va_start(args, fmt);
+        len = vsnprintf(pOut->pBuf, room, fmt, args);
+        va_end(args);
+        if (len < 0)
+        {
+            pOut->pBuf[0] = '\0';
+            pOut->truncated = TRUE;
+            return;
+        }
+        if ((size_t)len >= room)
+        {
+            // Longer than the whole buffer, keep the head of it
+            pOut->truncated = TRUE;
+            pOut->total += room - 1;
+            pOut->len = room - 1;
+            return;
+        }
+    }
+
+    pOut->total += len;
+    pOut->len += len;
+}
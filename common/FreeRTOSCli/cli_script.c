@@ -0,0 +1,285 @@
+/******************************************************************************
+
+@file  cli_script.c
+
+@brief Named AT command scripts kept in NV, e.g. "boot" run at start up.
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * A script is a list of AT command lines separated by ';', stored in one NV
+ * item per slot: name, then the text. Scripts run in the CLI executor thread
+ * between commands, one line at a time through the interpreter:
+ *     +SCRIPT:<line>,<OK|ERROR>        after each line
+ *     +SCRIPTDONE:<name>,<lines run>,<OK|ABORT>
+ * The first line that fails aborts the script. A line longer than
+ * CLI_SCRIPT_LINE_LENGTH - 1 is not run and fails.
+ * A line may request another script, which runs after this one. A script
+ * can not request itself, and at most CLI_SCRIPT_CHAIN_MAX scripts follow
+ * each other this way, so scripts requesting each other stop.
+ * Requests also come from the BLEAppUtil task (boot script), the pending
+ * and running state is shared under a critical section.
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <string.h>
+#include "icall_ble_api.h"
+#include <common/Drivers/NV/nvintf.h>
+#include <common/Drivers/NV/nvocmp.h>
+#include <common/FreeRTOSCli/cli_api.h>
+#include <app_nv_items.h>
+
+#define CLI_SCRIPT_SLOTS        APP_NV_SUBIDS_SCRIPT    // subID is the slot
+#define CLI_SCRIPT_LINE_LENGTH  128
+#define CLI_SCRIPT_CHAIN_MAX    4       // scripts requested by a script line, in a row
+
+typedef struct
+{
+    char name[CLI_SCRIPT_NAME_LEN];     // not terminated when it is full length
+    char text[CLI_SCRIPT_MAX_LENGTH];
+} cli_script_t;
+
+APP_NV_CHECK_LEN(SCRIPT, sizeof(cli_script_t));
+
+/* NV driver, loaded by the stack (ble_user_config.c) */
+extern NVINTF_nvFuncts_t nvintfFncStruct;
+
+/* === Local Variables ===*/
+static cli_script_t script;             // executor thread only
+static char scriptPendingName[CLI_SCRIPT_NAME_LEN];
+static uint8 scriptPendingDepth = 0;
+static volatile uint8 scriptPending = FALSE;
+static char scriptRunningName[CLI_SCRIPT_NAME_LEN];
+static uint8 scriptRunningDepth = 0;    // scripts requested by a script line before it
+static volatile uint8 scriptRunning = FALSE;
+
+static uint8 cli_scriptSameName(const char *pStored, const char *pName, size_t nameLen)
+{
+    return (strncmp(pStored, pName, nameLen) == 0 &&
+            (nameLen == CLI_SCRIPT_NAME_LEN || pStored[nameLen] == '\0'));
+}
+
+static NVINTF_itemID_t cli_scriptItemId(uint8 slot)
+{
+    return APP_NV_ID(SCRIPT, slot);
+}
+
+/* Slot holding the script, or CLI_SCRIPT_SLOTS. All names are read in one batch. */
+static uint8 cli_scriptFind(const char *pName, size_t nameLen)
+{
+    char names[CLI_SCRIPT_SLOTS][CLI_SCRIPT_NAME_LEN];
+    NVOCMP_batchItem_t items[CLI_SCRIPT_SLOTS];
+    uint8 slot;
+
+    if (nvintfFncStruct.readItem == NULL || nameLen == 0 || nameLen > CLI_SCRIPT_NAME_LEN)
+    { return CLI_SCRIPT_SLOTS; }
+
+    for (slot = 0; slot < CLI_SCRIPT_SLOTS; slot++)
+    {
+        items[slot].id = cli_scriptItemId(slot);
+        items[slot].len = CLI_SCRIPT_NAME_LEN;
+        items[slot].buffer = names[slot];
+        items[slot].status = NVINTF_NOTFOUND;
+    }
+
+    (void)NVOCMP_readBatch(items, CLI_SCRIPT_SLOTS);     // empty slots fail, status per item
+
+    for (slot = 0; slot < CLI_SCRIPT_SLOTS; slot++)
+    {
+        if (items[slot].status == NVINTF_SUCCESS &&
+            cli_scriptSameName(names[slot], pName, nameLen))
+        { return slot; }
+    }
+
+    return CLI_SCRIPT_SLOTS;
+}
+
+/* Store or replace a script, lines separated by ';' */
+bStatus_t cli_scriptStore(const char *pName, size_t nameLen, const char *pText, size_t textLen)
+{
+    static cli_script_t item;
+    uint8 slot;
+
+    if (nvintfFncStruct.writeItem == NULL || nameLen == 0 || nameLen > CLI_SCRIPT_NAME_LEN ||
+        textLen == 0 || textLen > CLI_SCRIPT_MAX_LENGTH)
+    { return FAILURE; }
+
+    slot = cli_scriptFind(pName, nameLen);
+    if (slot == CLI_SCRIPT_SLOTS)
+    {
+        // First free slot
+        for (slot = 0; slot < CLI_SCRIPT_SLOTS; slot++)
+        {
+            if (nvintfFncStruct.getItemLen(cli_scriptItemId(slot)) == 0)
+            { break; }
+        }
+        if (slot == CLI_SCRIPT_SLOTS)
+        { return FAILURE; }
+    }
+
+    memset(item.name, 0x00, CLI_SCRIPT_NAME_LEN);
+    memcpy(item.name, pName, nameLen);
+    memcpy(item.text, pText, textLen);
+
+    if (nvintfFncStruct.writeItem(cli_scriptItemId(slot), CLI_SCRIPT_NAME_LEN + textLen, &item) != NVINTF_SUCCESS)
+    { return FAILURE; }
+
+    return SUCCESS;
+}
+
+bStatus_t cli_scriptDelete(const char *pName, size_t nameLen)
+{
+    uint8 slot = cli_scriptFind(pName, nameLen);
+
+    if (slot == CLI_SCRIPT_SLOTS)
+    { return FAILURE; }
+
+    return (nvintfFncStruct.deleteItem(cli_scriptItemId(slot)) == NVINTF_SUCCESS) ? SUCCESS : FAILURE;
+}
+
+/*
+ * Write the names of the stored scripts and their length, one per line.
+ */
+void cli_scriptList(cli_output_t *pOut)
+{
+    char name[CLI_SCRIPT_NAME_LEN + 1];
+    uint32_t len;
+    uint8 slot;
+
+    if (nvintfFncStruct.readItem == NULL)
+    { return; }
+
+    for (slot = 0; slot < CLI_SCRIPT_SLOTS; slot++)
+    {
+        len = nvintfFncStruct.getItemLen(cli_scriptItemId(slot));
+        if (len <= CLI_SCRIPT_NAME_LEN ||
+            nvintfFncStruct.readItem(cli_scriptItemId(slot), 0, CLI_SCRIPT_NAME_LEN, name) != NVINTF_SUCCESS)
+        { continue; }
+
+        name[CLI_SCRIPT_NAME_LEN] = '\0';
+        cli_outAppendf(pOut, "+SCRIPT:%s,%u\r\n", name, (unsigned int)(len - CLI_SCRIPT_NAME_LEN));
+    }
+}
+
+/*
+ * Ask the executor thread to run a script. Fails if there is no such script,
+ * another one is waiting, it is the running script, or the running script
+ * ends a chain of CLI_SCRIPT_CHAIN_MAX requests.
+ */
+bStatus_t cli_scriptRequest(const char *pName, size_t nameLen)
+{
+    bStatus_t status = SUCCESS;
+    uint8 depth = 0;
+
+    if (cli_scriptFind(pName, nameLen) == CLI_SCRIPT_SLOTS)
+    { return FAILURE; }
+
+    taskENTER_CRITICAL();
+    if (scriptRunning)
+    { depth = scriptRunningDepth + 1; }
+
+    if (scriptPending || depth > CLI_SCRIPT_CHAIN_MAX ||
+        (scriptRunning && cli_scriptSameName(scriptRunningName, pName, nameLen)))
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        memset(scriptPendingName, 0x00, CLI_SCRIPT_NAME_LEN);
+        memcpy(scriptPendingName, pName, nameLen);
+        scriptPendingDepth = depth;
+        scriptPending = TRUE;
+    }
+    taskEXIT_CRITICAL();
+
+    if (status == SUCCESS)
+    { cli_execResumeByPostSemaphore(); }
+    return status;
+}
+
+/* Run the requested script. Called from the CLI executor thread only. */
+void cli_scriptRunPending(void)
+{
+    char name[CLI_SCRIPT_NAME_LEN + 1];
+    char line[CLI_SCRIPT_LINE_LENGTH];
+    char rsp[40 + CLI_SCRIPT_NAME_LEN];
+    uint8 result = CLI_RESULT_OK;
+    uint32_t itemLen;
+    size_t textLen, pos = 0, lineLen;
+    uint16 numLines = 0;
+    uint8 tooLong;
+    uint8 slot;
+    int len;
+
+    if (!scriptPending)
+    { return; }
+
+    // A line may request the next script, it runs after this one
+    taskENTER_CRITICAL();
+    memcpy(name, scriptPendingName, CLI_SCRIPT_NAME_LEN);
+    memcpy(scriptRunningName, scriptPendingName, CLI_SCRIPT_NAME_LEN);
+    scriptRunningDepth = scriptPendingDepth;
+    scriptRunning = TRUE;
+    scriptPending = FALSE;
+    taskEXIT_CRITICAL();
+    name[CLI_SCRIPT_NAME_LEN] = '\0';
+
+    slot = cli_scriptFind(name, strlen(name));
+    itemLen = (slot == CLI_SCRIPT_SLOTS) ? 0 : nvintfFncStruct.getItemLen(cli_scriptItemId(slot));
+    if (itemLen <= CLI_SCRIPT_NAME_LEN || itemLen > sizeof(script) ||
+        nvintfFncStruct.readItem(cli_scriptItemId(slot), 0, itemLen, &script) != NVINTF_SUCCESS)
+    {
+        scriptRunning = FALSE;
+        return; // deleted since the request
+    }
+    textLen = itemLen - CLI_SCRIPT_NAME_LEN;
+
+    while (pos < textLen)
+    {
+        // Next line, without the ';' and leading spaces
+        while (pos < textLen && (script.text[pos] == ';' || script.text[pos] == ' '))
+        { pos++; }
+        lineLen = 0;
+        tooLong = FALSE;
+        while (pos < textLen && script.text[pos] != ';')
+        {
+            if (lineLen < CLI_SCRIPT_LINE_LENGTH - 1)
+            { line[lineLen++] = script.text[pos]; }
+            else if (script.text[pos] != ' ')
+            { tooLong = TRUE; }
+            pos++;
+        }
+        while (lineLen > 0 && line[lineLen - 1] == ' ')
+        { lineLen--; }
+        if (lineLen == 0)
+        { continue; }
+        line[lineLen] = '\0';
+
+        // A cut line would run as another command, fail it instead
+        numLines++;
+        result = tooLong ? CLI_RESULT_ERROR : cli_uartCmdRunLine(line);
+
+        len = sprintf(rsp, "\r\n+SCRIPT:%u,%s\r\n", numLines,
+                      (result == CLI_RESULT_OK) ? "OK" : "ERROR");
+        cli_uartCmdOutput(rsp, len);
+
+        if (result != CLI_RESULT_OK)
+        { break; }
+    }
+
+    scriptRunning = FALSE;
+
+    len = sprintf(rsp, "\r\n+SCRIPTDONE:%s,%u,%s\r\n", name, numLines,
+                  (result == CLI_RESULT_OK) ? "OK" : "ABORT");
+    cli_uartCmdOutput(rsp, len);
+}
@@ -6,7 +6,9 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <FreeRTOS.h>
+#include <task.h>
 #include "FreeRTOS_CLI.h"
 #include <string.h>
 #include <pthread.h>
@@ -20,6 +22,9 @@
 #include <app_main.h>
 #include <common/FreeRTOSCli/cli_api.h>
 #include <common/Drivers/UART/trans_uartApi.h>
+#include <common/Drivers/NV/nv_cache.h>
+#include <common/Drivers/NV/nvocmp.h>
+#include <common/Drivers/NV/nv_log.h>
 #include "icall_ble_api.h"
 
 //#define MAX_COMMAND_COUNT 4
@@ -30,15 +35,20 @@ extern BLEAppUtil_TheardEntity_t BLEAppUtil_theardEntity;
 extern int BLEAppUtil_createBLEAppUtilTask(void);
 
 /* Local function */
-static inline void cli_writeError(char *pcWriteBuffer){ strcpy(pcWriteBuffer, "\r\nERROR\r\n"); }
+static inline void cli_writeError(char *pcWriteBuffer){ strcpy(pcWriteBuffer, cli_uartCmdSetResult(CLI_RESULT_ERROR)); }
 
-static inline void cli_writeOK(char *pcWriteBuffer){ strcpy(pcWriteBuffer, "\r\nOK\r\n"); }
+static inline void cli_writeOK(char *pcWriteBuffer){ strcpy(pcWriteBuffer, cli_uartCmdSetResult(CLI_RESULT_OK)); }
 
-static inline void cli_writeRsp(char *pcWriteBuffer, const char* val, size_t len)
+// val is up to len chars, terminated earlier if shorter
+static inline void cli_writeRsp(char *pcWriteBuffer, size_t xWriteBufferLen, const char* val, size_t len)
 {
-    strcpy(pcWriteBuffer, "\r\n");
-    strncat(pcWriteBuffer, val, len);
-    strncat(pcWriteBuffer, "\r\n", strlen("\r\n"));
+    const char *pEnd = memchr(val, '\0', len);
+    cli_output_t out;
+
+    cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+    cli_outAppend(&out, "\r\n", 2);
+    cli_outAppend(&out, val, (pEnd != NULL) ? (size_t)(pEnd - val) : len);
+    cli_outAppend(&out, "\r\n", 2);
 }
 
 static BaseType_t prvAT_ECHOfxn( char *pcWriteBuffer,
@@ -92,6 +102,33 @@ static BaseType_t prvAT_BLESTATfxn( char *pcWriteBuffer,
 static BaseType_t prvAT_RSTfxn( char *pcWriteBuffer,
                                 size_t xWriteBufferLen,
                                 const char *pcCommandString );
+static BaseType_t prvAT_HEAPSTATfxn( char *pcWriteBuffer,
+                                     size_t xWriteBufferLen,
+                                     const char *pcCommandString );
+static BaseType_t prvAT_BLESCANfxn( char *pcWriteBuffer,
+                                     size_t xWriteBufferLen,
+                                     const char *pcCommandString );
+static BaseType_t prvAT_URCfxn( char *pcWriteBuffer,
+                                size_t xWriteBufferLen,
+                                const char *pcCommandString );
+static BaseType_t prvAT_BINMODEfxn( char *pcWriteBuffer,
+                                    size_t xWriteBufferLen,
+                                    const char *pcCommandString );
+static BaseType_t prvAT_SAVEfxn( char *pcWriteBuffer,
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString );
+static BaseType_t prvAT_SCRIPTfxn( char *pcWriteBuffer,
+                                   size_t xWriteBufferLen,
+                                   const char *pcCommandString );
+static BaseType_t prvAT_FACTORYfxn( char *pcWriteBuffer,
+                                    size_t xWriteBufferLen,
+                                    const char *pcCommandString );
+static BaseType_t prvAT_NVSTATfxn( char *pcWriteBuffer,
+                                   size_t xWriteBufferLen,
+                                   const char *pcCommandString );
+static BaseType_t prvAT_LOGDUMPfxn( char *pcWriteBuffer,
+                                    size_t xWriteBufferLen,
+                                    const char *pcCommandString );
 static BaseType_t prvAT_BLESTOPfxn( char *pcWriteBuffer,
                                       size_t xWriteBufferLen,
                                       const char *pcCommandString ); // none-use
@@ -104,103 +141,194 @@ void cli_init(void){
 	  "AT+ECHO",
 	  "AT+ECHO <enable>  : <enable>=1, turn on echo. <enable>=0 turn off echo.\r\n",
 	  prvAT_ECHOfxn,
-	  1
+	  1,
+	  0x01
 	 },
 	 {
 	  "AT+SETBAUD",
 	  "AT+SETBAUD <baudrate>: \r\n",
 	  prvAT_SETBAUDfxn,
-	  1
+	  1,
+	  0x02
 	 },
 	 {
 	  "AT+TXPOWER",
-	  "AT+TXPOWER <txpower>: \r\n",
+	  "AT+TXPOWER [dBm] [adv [handle]]: Set the default TX power, or the power of an advertising set.\r\n"
+	  "                    No parameter shows the levels: +TXPOWER:<default>,<adv>, +TXPOWERLEVELS:<dBm>,...\r\n",
 	  prvAT_TXPOWERfxn,
-	  1
+	  -1, // query without parameter
+	  0x03
 	 },
 	 {
 	  "AT+BLESTART",
 	  "AT+BLESTART       : Start BLE default service with advertisement going on.\r\n",
 	  prvAT_BLESTARTfxn,
-	  0   // Could input role as argument
+	  0,   // Could input role as argument
+	  0x10
 	 },
 	 {
 	  "AT+BLEADVSTART",
 	  "AT+BLEADVSTART    : Start advertising.\r\n",
 	  prvAT_BLEADVSTARTfxn,
-	  0
+	  0,
+	  0x11
 	 },
 	 {
 	  "AT+BLEADVSTOP",
 	  "AT+BLEADVSTOP     : Stop advertising.\r\n",
 	  prvAT_BLEADVSTOPfxn,
-	  0
+	  0,
+	  0x12
 	 },
 	 {
 	  "AT+BLEADDR",
 	  "AT+BLEADDR        : Show BLE address.\r\n",
 	  prvAT_BLEADDRfxn,
-	  0
+	  0,
+	  0x13
 	 },
 	 {
 	  "AT+BLENAME",
 	  "AT+BLENAME        : Show BLE name.\r\n",
 	  prvAT_BLENAMEfxn,
-	  0
+	  0,
+	  0x14
 	 },
 	 {
 	  "AT+VERSION",
 	  "AT+VERSION        : Show firmware version\r\n",
 	  prvAT_VERSIONfxn,
-	  0
+	  0,
+	  0x04
 	 },
 	 {
 	  "AT+BLEADVPARAM",
 	  "AT+BLEADVPARAM <min> <max>: Set advertise interval between integer <min> to <max> (unit: 0.625 ms).\r\n",
 	  prvAT_BLEADVPARAMfxn,
-	  2
+	  2,
+	  0x15
 	 },
 	 {
 	  "AT+BLECONNPARAM",
 	  "AT+BLECONNPARAM <param_name> <value>: \r\n",
 	  prvAT_BLECONNPARAMfxn,
-	  0
+	  0,
+	  0x16
 	 },
 	 {
 	  "AT+BLETRANMODE",
 	  "AT+BLETRANMODE    : Start transparent mode between UART and characteristic 0xFFF1 & 0xFFF2. UART key in \"\\r\\n+++\\r\\n\" to stop.\r\n",
 	  prvAT_BLETRANMODEfxn,
-	  0
+	  0,
+	  0x17
 	 },
 	 {
 	  "+++",
 	  "",         // hide from command list.
 	  prvSTOPTRANMODEfxn,
-	  0
+	  0,
+	  0  // text only
 	 },
 	 {
 	  "AT+BLEPERINTFY",
 	  "AT+BLEPERINTFY <stringNoQuote>: Peripheral role send notify to default UUID.\r\n",
 	  prvAT_BLEPERINTFYfxn,
-	  1
+	  1,
+	  0x18
 	 },
 	 {
 	  "AT+BLEDISCONN",
 	  "AT+BLEDISCONN     : BLE disconnect all links. \r\n",
 	  prvAT_BLEDISCONNfxn,
-	  0
+	  0,
+	  0x19
 	 },
 	 {
 	  "AT+BLESTAT",
 	  "AT+BLESTAT        : Show BLE status. \r\n",
 	  prvAT_BLESTATfxn,
-	  0
+	  0,
+	  0x1A
 	 },
 	 {
 	  "AT+RST",
 	  "AT+RST            : Reset device immediately.\r\n",
 	  prvAT_RSTfxn,
-	  0
+	  0,
+	  0x05
+	 },
+	 {
+	  "AT+HEAPSTAT",
+	  "AT+HEAPSTAT       : Show heap usage, fragmentation and usage per subsystem (debug builds with\r\n"
+	  "                    ICALL_HEAP_TAGGING only), then the ICall worker thread:\r\n"
+	  "                    +WORKER:<jobs>,<rejected>,<inline arg>,<avg us>,<max us>,<queue high water>,<depth>,<max batch>.\r\n",
+	  prvAT_HEAPSTATfxn,
+	  0,
+	  0x06
+	 },
+	 {
+	  "AT+BLESCAN",
+	  "AT+BLESCAN <sec> [rssi>=N] [name=prefix] [uuid=XXXX] [mfg=XXXX]: Scan for <sec> seconds, <sec>=0 stops.\r\n"
+	  "                    Matching devices are reported as +SCAN:<addr>,<type>,<rssi>,<data>, then +SCANDONE:<count>,<dropped>.\r\n",
+	  prvAT_BLESCANfxn,
+	  -1,  // filters are optional
+	  0x1B
+	 },
+	 {
+	  "AT+URC",
+	  "AT+URC [mask]     : Show or set the URC mask. 0x01 +CONN, 0x02 +DISC, 0x04 +MTU, 0x08 +PHY, 0x10 +CCC.\r\n"
+	  "                    Shows +URC:<mask>,<dropped URCs> and +UART:<dropped RX bytes>.\r\n",
+	  prvAT_URCfxn,
+	  -1,  // no mask to query
+	  0x07
+	 },
+	 {
+	  "AT+BINMODE",
+	  "AT+BINMODE        : Switch to binary frames (SOF 0xA5), opcode 0x7F switches back. Frames may follow\r\n"
+	  "                    the line without waiting for OK. Output over 512 bytes answers status 0x05.\r\n",
+	  prvAT_BINMODEfxn,
+	  0,
+	  0   // already in binary mode
+	 },
+	 {
+	  "AT&W",
+	  "AT&W              : Save echo, URC mask, adv interval, TX power and adv on/off, applied at boot.\r\n",
+	  prvAT_SAVEfxn,
+	  0,
+	  0x09
+	 },
+	 {
+	  "AT&F",
+	  "AT&F              : Restore factory settings, AT&W to keep them.\r\n",
+	  prvAT_FACTORYfxn,
+	  0,
+	  0x0A
+	 },
+	 {
+	  "AT+SCRIPT",
+	  "AT+SCRIPT [name] [cmd;cmd;...|-]: Store a script, - deletes it. With only <name> run it, no parameter lists them.\r\n"
+	  "                    \"boot\" runs at start up. Results: +SCRIPT:<line>,<result>, +SCRIPTDONE:<name>,<lines>,<OK|ABORT>.\r\n",
+	  prvAT_SCRIPTfxn,
+	  -1, // commands contain spaces
+	  0x0B
+	 },
+	 {
+	  "AT+NVSTAT",
+	  "AT+NVSTAT         : Show NV wear: +NVSTAT:<pages>,<live>,<dead>,<free> bytes, +NVCYCLE:<page cycles>,\r\n"
+	  "                    +NVCOMPACT:<count>,<last>,<max>,<total> ms, +NVLIFE:<erases>,<days to endurance at this rate>,\r\n"
+	  "                    +NVCACHE:<cached writes>,<unchanged>,<flash writes>,<saved>, +NVTASK:<stack>,<min free> bytes.\r\n"
+	  "                    NVLIFE counts only the wear since boot.\r\n",
+	  prvAT_NVSTATfxn,
+	  0,
+	  0x0C
+	 },
+	 {
+	  "AT+LOGDUMP",
+	  "AT+LOGDUMP [0]    : Dump the NV event log, oldest first: +LOG:<seq>,<ms since boot>,<type>,<hex data>,\r\n"
+	  "                    then +LOGDONE:<records>. Types 1 boot, 2 assert, 3 disconnect, 4 throughput. 0 clears it.\r\n",
+	  prvAT_LOGDUMPfxn,
+	  -1, // nothing to clear
+	  0x0D
 	 }
     };
 
@@ -234,9 +362,11 @@ static BaseType_t prvAT_ECHOfxn( char *pcWriteBuffer,
     {
     case '0':
         ret = cli_uartSetEchoOnOff(CLI_UART_NO_ECHO);
+        Settings_set(echo, CLI_UART_NO_ECHO);
         break;
     case '1':
         ret = cli_uartSetEchoOnOff(CLI_UART_ECHO);
+        Settings_set(echo, CLI_UART_ECHO);
         break;
     default:
         cli_writeError(pcWriteBuffer);
@@ -263,7 +393,84 @@ static BaseType_t prvAT_TXPOWERfxn( char *pcWriteBuffer,
                                           size_t xWriteBufferLen,
                                           const char *pcCommandString )
 {
-	return pdFALSE;
+    bStatus_t status = SUCCESS;
+    const char *pcParameter1, *pcParameter2, *pcParameter3;
+    BaseType_t xParameter1StringLength, xParameter2StringLength, xParameter3StringLength;
+    int8 levels[APP_TXPOWER_MAX_LEVELS];
+    cli_output_t out;
+    uint8 numLevels, i;
+    char *pcEnd;
+    long value;
+    uint8 advHandle;
+    int8 dBm;
+
+    pcParameter1 = FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameter1StringLength);
+    if (pcParameter1 == NULL)
+    {
+        numLevels = TxPower_getLevels(levels, APP_TXPOWER_MAX_LEVELS);
+        Settings_lock();
+        dBm = Settings_get()->advTxPower;
+        Settings_unlock();
+
+        cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+        cli_outResult(&out, CLI_RESULT_OK);
+        cli_outAppendf(&out, "+TXPOWER:%d,%d\r\n+TXPOWERLEVELS:",
+                       TxPower_getDefault(), dBm);
+        for (i = 0; i < numLevels; i++)
+        { cli_outAppendf(&out, (i == 0) ? "%d" : ",%d", levels[i]); }
+        cli_outAppend(&out, "\r\n", 2);
+        return pdFALSE;
+    }
+
+    if (BLEAppUtil_theardEntity.threadId == NULL)
+    { cli_writeError(pcWriteBuffer); return pdFALSE; }
+
+    // Decimal dBm, APP_TXPOWER_NOT_SET is not a level
+    value = strtol(pcParameter1, &pcEnd, 10);
+    if (pcEnd != pcParameter1 + xParameter1StringLength ||
+        value < INT8_MIN || value >= APP_TXPOWER_NOT_SET)
+    { cli_writeError(pcWriteBuffer); return pdFALSE; }
+    dBm = (int8)value;
+
+    pcParameter2 = FreeRTOS_CLIGetParameter(pcCommandString, 2, &xParameter2StringLength);
+    if (pcParameter2 == NULL)
+    {
+        status = TxPower_setDefault(dBm);
+        if (status == SUCCESS)
+        { Settings_set(txPower, dBm); }
+    }
+    else if (xParameter2StringLength == 3 && strncmp(pcParameter2, "adv", 3) == 0)
+    {
+        pcParameter3 = FreeRTOS_CLIGetParameter(pcCommandString, 3, &xParameter3StringLength);
+        advHandle = Peripheral_getAdvHandle();
+        if (pcParameter3 != NULL)
+        {
+            value = strtol(pcParameter3, &pcEnd, 10);
+            if (pcEnd != pcParameter3 + xParameter3StringLength || value < 0 || value > UINT8_MAX)
+            { cli_writeError(pcWriteBuffer); return pdFALSE; }
+            advHandle = (uint8)value;
+        }
+
+        if (advHandle == Peripheral_getAdvHandle())
+        {
+            status = TxPower_setAdv(Peripheral_getAdvHandle(), dBm);
+            if (status == SUCCESS)
+            { Settings_set(advTxPower, dBm); }
+        }
+        else
+        {
+            // Not kept by AT&W, only the peripheral set is restored at boot
+            status = TxPower_setAdv(advHandle, dBm);
+        }
+    }
+    else
+    { status = FAILURE; }
+
+    if (status == SUCCESS)
+    { cli_writeOK(pcWriteBuffer); }
+    else
+    { cli_writeError(pcWriteBuffer); }
+    return pdFALSE;
 }
 static BaseType_t prvAT_BLESTARTfxn( char *pcWriteBuffer,
                                           size_t xWriteBufferLen,
@@ -335,7 +542,7 @@ static BaseType_t prvAT_BLEADDRfxn( char *pcWriteBuffer,
     bleStk_getDevAddr(TRUE, getAddr);
     char* strAddr = BLEAppUtil_convertBdAddr2Str(getAddr);
 
-    cli_writeRsp(pcWriteBuffer, strAddr, 2*B_ADDR_LEN+3);
+    cli_writeRsp(pcWriteBuffer, xWriteBufferLen, strAddr, 2*B_ADDR_LEN+3);
 
     return pdFALSE;
 }
@@ -355,7 +562,7 @@ static BaseType_t prvAT_BLENAMEfxn( char *pcWriteBuffer,
         return pdFALSE;
     }
 
-    cli_writeRsp(pcWriteBuffer, buffer, GAP_DEVICE_NAME_LEN);
+    cli_writeRsp(pcWriteBuffer, xWriteBufferLen, buffer, GAP_DEVICE_NAME_LEN);
     return pdFALSE;
 }
 static BaseType_t prvAT_VERSIONfxn( char *pcWriteBuffer,
@@ -374,7 +581,7 @@ static BaseType_t prvAT_VERSIONfxn( char *pcWriteBuffer,
         return pdFALSE;
     }
 
-    cli_writeRsp(pcWriteBuffer, buffer, DEVINFO_STR_ATTR_LEN+1);
+    cli_writeRsp(pcWriteBuffer, xWriteBufferLen, buffer, DEVINFO_STR_ATTR_LEN+1);
     return pdFALSE;
 }
 static BaseType_t prvAT_BLEADVPARAMfxn( char *pcWriteBuffer,
@@ -396,7 +603,13 @@ static BaseType_t prvAT_BLEADVPARAMfxn( char *pcWriteBuffer,
 	status |= Peripheral_setAdvParam( GAP_ADV_PARAM_PRIMARY_INTERVAL_MAX, &interval_max);
 
 	if(status == SUCCESS)
-	{ cli_writeOK(pcWriteBuffer); }
+	{
+		Settings_lock();
+		Settings_get()->advIntMin = interval_min;
+		Settings_get()->advIntMax = interval_max;
+		Settings_unlock();
+		cli_writeOK(pcWriteBuffer);
+	}
 	else
 	{ cli_writeError(pcWriteBuffer); }
 
@@ -440,6 +653,7 @@ static BaseType_t prvAT_BLEPERINTFYfxn( char *pcWriteBuffer,
 {
     bStatus_t status = SUCCESS;
     gattAttribute_t* pAttr = DSS_getDefaultNotifyGatt();
+    cli_output_t out;
 
     if (pAttr == NULL)
     { cli_writeError(pcWriteBuffer); return pdFALSE; }
@@ -454,8 +668,9 @@ static BaseType_t prvAT_BLEPERINTFYfxn( char *pcWriteBuffer,
     if(status != SUCCESS)
     { cli_writeError(pcWriteBuffer); return pdFALSE; }
 
-    cli_writeOK(pcWriteBuffer);
-    sprintf(pcWriteBuffer + strlen(pcWriteBuffer),"UUID: %02X%02X , handle: %04X\r\n", *(pAttr->type.uuid+1), *pAttr->type.uuid, pAttr->handle);
+    cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+    cli_outResult(&out, CLI_RESULT_OK);
+    cli_outAppendf(&out, "UUID: %02X%02X , handle: %04X\r\n", *(pAttr->type.uuid+1), *pAttr->type.uuid, pAttr->handle);
 
     return pdFALSE;
 }
@@ -492,8 +707,10 @@ static BaseType_t prvAT_BLESTATfxn( char *pcWriteBuffer,
     if (BLEAppUtil_theardEntity.threadId != NULL)
     {
     AppMonitor_report_t report = Monitor_getStateReport();
-    cli_writeOK(pcWriteBuffer);
-    sprintf(pcWriteBuffer+strlen(pcWriteBuffer),
+    cli_output_t out;
+    cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+    cli_outResult(&out, CLI_RESULT_OK);
+    cli_outAppendf(&out,
             "BLE Role: %s\r\nState - [ Init: %s ], [ Advertising: %s ], [ Connection(s): %d ]\r\n",
             report.role, report.initYet, report.advOnOff, report.connNum);
     }
@@ -509,9 +726,341 @@ static BaseType_t prvAT_RSTfxn( char *pcWriteBuffer,
 {
     // buffer string may not meet display time.
     cli_writeOK(pcWriteBuffer);
+    // NV writes held in RAM
+    nvCache_flush();
     PMCTLResetSystem();
     return pdFALSE;
 }
+static BaseType_t prvAT_HEAPSTATfxn( char *pcWriteBuffer,
+                                     size_t xWriteBufferLen,
+                                     const char *pcCommandString )
+{
+    static const char * const tagNames[ICALL_HEAP_TAG_NUM] =
+    { "STACK", "BLEAPPUTIL", "DSS", "WORKER" };
+    ICall_heapStats_t heapStats;
+    ICall_heapTagStats_t tagStats;
+#ifdef CC23X0
+    ICall_workerThreadStats_t workerStats;
+#endif
+    cli_output_t out;
+    uint32 frag = 0;
+    uint8 tag;
+
+    ICall_getHeapStats(&heapStats);
+
+    // Fragmentation: share of the free memory not usable by the largest allocation
+    if (heapStats.totalFreeSize > 0)
+    {
+        frag = 100 - ((heapStats.largestFreeSize * 100) / heapStats.totalFreeSize);
+    }
+
+    cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+    cli_outResult(&out, CLI_RESULT_OK);
+    cli_outAppendf(&out, "Heap: total %u, free %u, largest free %u, frag %u%%\r\n",
+                   heapStats.totalSize, heapStats.totalFreeSize, heapStats.largestFreeSize, frag);
+
+    for (tag = 0; tag < ICALL_HEAP_TAG_NUM; tag++)
+    {
+        if (ICall_getHeapTagStats(tag, &tagStats) != ICALL_ERRNO_SUCCESS)
+        { break; } // tagging not built, a debug option (ICALL_HEAP_TAGGING)
+
+        cli_outAppendf(&out, "%-10s live %u, peak %u, blocks %u, fails %u\r\n",
+                       tagNames[tag], tagStats.liveBytes, tagStats.peakBytes,
+                       tagStats.liveBlocks, tagStats.allocFails);
+    }
+
+#ifdef CC23X0
+    // ICall worker thread, its large arguments are on the heap (WORKER)
+    ICall_workerThreadGetStats(&workerStats);
+    cli_outAppendf(&out, "+WORKER:%u,%u,%u,%u,%u,%u,%u,%u\r\n",
+                   (unsigned int)workerStats.jobsDone, (unsigned int)workerStats.jobsRejected,
+                   (unsigned int)workerStats.jobsInline,
+                   (unsigned int)((workerStats.jobsDone == 0) ? 0 :
+                                  (workerStats.totalJobTicks / workerStats.jobsDone) * ICall_getTickPeriod()),
+                   (unsigned int)(workerStats.maxJobTicks * ICall_getTickPeriod()),
+                   workerStats.queueHighWater, workerStats.queueDepth, workerStats.maxBatch);
+#endif
+
+    return pdFALSE;
+}
+static BaseType_t prvAT_BLESCANfxn( char *pcWriteBuffer,
+                                     size_t xWriteBufferLen,
+                                     const char *pcCommandString )
+{
+    bStatus_t status = SUCCESS;
+    const char *pcParameter;
+    BaseType_t xParameterStringLength;
+    App_scanFilter filter;
+    uint16 duration;
+    int i;
+
+    if (BLEAppUtil_theardEntity.threadId == NULL)
+    { cli_writeError(pcWriteBuffer); return pdFALSE; }
+
+    pcParameter = FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+    if (pcParameter == NULL)
+    { cli_writeError(pcWriteBuffer); return pdFALSE; }
+    duration = atoi(pcParameter);
+
+    memset(&filter, 0x00, sizeof(filter));
+    for (i = 2; (pcParameter = FreeRTOS_CLIGetParameter(pcCommandString, i, &xParameterStringLength)) != NULL; i++)
+    {
+        if (strncmp(pcParameter, "rssi>=", 6) == 0)
+        {
+            filter.flags |= APP_SCAN_FILTER_RSSI;
+            filter.minRssi = (int8)atoi(pcParameter + 6);
+        }
+        else if (strncmp(pcParameter, "name=", 5) == 0 &&
+                 xParameterStringLength > 5 &&
+                 xParameterStringLength - 5 <= APP_SCAN_FILTER_NAME_LEN)
+        {
+            filter.flags |= APP_SCAN_FILTER_NAME;
+            filter.nameLen = xParameterStringLength - 5;
+            memcpy(filter.namePrefix, pcParameter + 5, filter.nameLen);
+        }
+        else if (strncmp(pcParameter, "uuid=", 5) == 0 && xParameterStringLength == 9)
+        {
+            filter.flags |= APP_SCAN_FILTER_UUID;
+            filter.uuid = (uint16)strtoul(pcParameter + 5, NULL, 16);
+        }
+        else if (strncmp(pcParameter, "mfg=", 4) == 0 && xParameterStringLength == 8)
+        {
+            filter.flags |= APP_SCAN_FILTER_MFG;
+            filter.mfgId = (uint16)strtoul(pcParameter + 4, NULL, 16);
+        }
+        else
+        {
+            // unknown or malformed filter
+            cli_writeError(pcWriteBuffer);
+            return pdFALSE;
+        }
+    }
+
+    if (duration == 0)
+    { status = Observer_scanStreamStop(); }
+    else
+    { status = Observer_scanStreamStart(duration, &filter); }
+
+    if (status == SUCCESS)
+    { cli_writeOK(pcWriteBuffer); }
+    else
+    { cli_writeError(pcWriteBuffer); }
+
+    return pdFALSE;
+}
+static BaseType_t prvAT_URCfxn( char *pcWriteBuffer,
+                                size_t xWriteBufferLen,
+                                const char *pcCommandString )
+{
+    const char *pcParameter1;
+    BaseType_t xParameter1StringLength;
+    cli_output_t out;
+    char *pcEnd;
+    unsigned long mask;
+
+    pcParameter1 = FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameter1StringLength);
+    if (pcParameter1 != NULL)
+    {
+        // decimal or 0x prefixed hex
+        mask = strtoul(pcParameter1, &pcEnd, 0);
+        if (pcEnd != pcParameter1 + xParameter1StringLength || mask > CLI_URC_ALL)
+        { cli_writeError(pcWriteBuffer); return pdFALSE; }
+
+        cli_urcSetMask((uint8)mask);
+        Settings_set(urcMask, (uint8)mask);
+    }
+
+    cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+    cli_outResult(&out, CLI_RESULT_OK);
+    cli_outAppendf(&out, "+URC:0x%02X,%u\r\n+UART:%u\r\n",
+                   cli_urcGetMask(), (unsigned int)cli_urcGetDropped(),
+                   (unsigned int)cli_uartGetRxDropped());
+    return pdFALSE;
+}
+static BaseType_t prvAT_SAVEfxn( char *pcWriteBuffer,
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString )
+{
+    if (Settings_save() == SUCCESS)
+    { cli_writeOK(pcWriteBuffer); }
+    else
+    { cli_writeError(pcWriteBuffer); }
+    return pdFALSE;
+}
+static BaseType_t prvAT_SCRIPTfxn( char *pcWriteBuffer,
+                                   size_t xWriteBufferLen,
+                                   const char *pcCommandString )
+{
+    bStatus_t status = SUCCESS;
+    const char *pcName, *pcText;
+    BaseType_t xNameLength, xTextLength;
+    cli_output_t out;
+
+    pcName = FreeRTOS_CLIGetParameter(pcCommandString, 1, &xNameLength);
+    if (pcName == NULL)
+    {
+        cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+        cli_outResult(&out, CLI_RESULT_OK);
+        cli_scriptList(&out);
+        return pdFALSE;
+    }
+
+    pcText = FreeRTOS_CLIGetParameter(pcCommandString, 2, &xTextLength);
+    if (pcText == NULL)
+    {
+        // Runs after this command has answered
+        status = cli_scriptRequest(pcName, xNameLength);
+    }
+    else if (xTextLength == 1 && *pcText == '-' && pcText[1] == '\0')
+    {
+        status = cli_scriptDelete(pcName, xNameLength);
+    }
+    else
+    {
+        // The rest of the line, spaces included
+        status = cli_scriptStore(pcName, xNameLength, pcText, strlen(pcText));
+    }
+
+    if (status == SUCCESS)
+    { cli_writeOK(pcWriteBuffer); }
+    else
+    { cli_writeError(pcWriteBuffer); }
+    return pdFALSE;
+}
+static BaseType_t prvAT_FACTORYfxn( char *pcWriteBuffer,
+                                    size_t xWriteBufferLen,
+                                    const char *pcCommandString )
+{
+    // Echo may be turned back on before the OK goes out
+    if (Settings_factoryReset() == SUCCESS)
+    { cli_writeOK(pcWriteBuffer); }
+    else
+    { cli_writeError(pcWriteBuffer); }
+    return pdFALSE;
+}
+static BaseType_t prvAT_NVSTATfxn( char *pcWriteBuffer,
+                                   size_t xWriteBufferLen,
+                                   const char *pcCommandString )
+{
+#ifdef NVOCMP_WEAR_STATS
+    NVOCMP_wearStats_t stats;
+    nvCache_stats_t cacheStats;
+    cli_output_t out;
+    uint32_t uptime = xTaskGetTickCount() / configTICK_RATE_HZ;  // seconds
+    uint64_t endurance;     // erases of all the pages
+    uint32_t stackSize, stackFree;
+    uint8 i;
+
+    if (NVOCMP_getWearStats(&stats) != NVINTF_SUCCESS)
+    { cli_writeError(pcWriteBuffer); return pdFALSE; }
+
+    cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+    cli_outResult(&out, CLI_RESULT_OK);
+    cli_outAppendf(&out, "+NVSTAT:%u,%u,%u,%u\r\n+NVCYCLE:", stats.nvPages,
+                   (unsigned int)stats.liveBytes, (unsigned int)stats.deadBytes,
+                   (unsigned int)stats.freeBytes);
+    for (i = 0; i < stats.nvPages; i++)
+    { cli_outAppendf(&out, (i == 0) ? "%u" : ",%u", stats.cycle[i]); }
+    cli_outAppendf(&out, "\r\n+NVCOMPACT:%u,%u,%u,%u\r\n",
+                   (unsigned int)stats.compactions, (unsigned int)stats.compactTimeLast,
+                   (unsigned int)stats.compactTimeMax, (unsigned int)stats.compactTimeTotal);
+
+    // Compaction moves round the pages, each one gets erases / pages of the erases.
+    // Days until the erases since boot, and those still to come at the same rate,
+    // reach the endurance. Wear from before this boot is not known, the page
+    // cycles roll over, so on a used part this is an upper bound.
+    if (stats.erases == 0 || uptime == 0)
+    { cli_outAppend(&out, "+NVLIFE:0,-\r\n", 13); }
+    else
+    {
+        endurance = (uint64_t)NVOCMP_FLASH_ENDURANCE * stats.nvPages;
+        cli_outAppendf(&out, "+NVLIFE:%u,%u\r\n", (unsigned int)stats.erases,
+                       (unsigned int)((endurance > stats.erases) ?
+                                      ((endurance - stats.erases) * uptime) / stats.erases / 86400 : 0));
+    }
+
+    nvCache_getStats(&cacheStats);
+    cli_outAppendf(&out, "+NVCACHE:%u,%u,%u,%u\r\n", (unsigned int)cacheStats.writes,
+                   (unsigned int)cacheStats.unchanged, (unsigned int)cacheStats.flashWrites,
+                   (unsigned int)(cacheStats.writes - cacheStats.flashWrites));
+
+    NvTask_getStack(&stackSize, &stackFree);
+    cli_outAppendf(&out, "+NVTASK:%u,%u\r\n", (unsigned int)stackSize, (unsigned int)stackFree);
+#else
+    cli_writeError(pcWriteBuffer);
+#endif
+    return pdFALSE;
+}
+typedef struct
+{
+    cli_output_t *pOut;
+    uint32_t count;
+} cli_logDump_t;
+
+static bool cli_logDumpRecord(const nvLog_hdr_t *pHdr, const uint8_t *pData, void *arg)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    cli_logDump_t *pDump = (cli_logDump_t *)arg;
+    char hex[2 * NV_LOG_MAX_DATA + 2];
+    uint16_t i;
+
+    for (i = 0; i < pHdr->len; i++)
+    {
+        hex[2 * i] = hexDigits[pData[i] >> 4];
+        hex[2 * i + 1] = hexDigits[pData[i] & 0x0F];
+    }
+    hex[2 * i] = '\r';
+    hex[2 * i + 1] = '\n';
+
+    // Flushed to the UART as the buffer fills, the log may be longer than it
+    cli_outAppendf(pDump->pOut, "+LOG:%u,%u,%u,", (unsigned int)pHdr->seq,
+                   (unsigned int)pHdr->time, pHdr->type);
+    cli_outAppend(pDump->pOut, hex, 2 * i + 2);
+    pDump->count++;
+    return true;
+}
+static BaseType_t prvAT_LOGDUMPfxn( char *pcWriteBuffer,
+                                    size_t xWriteBufferLen,
+                                    const char *pcCommandString )
+{
+    const char *pcParameter1;
+    BaseType_t xParameter1StringLength;
+    cli_output_t out;
+    cli_logDump_t dump = { &out, 0 };
+
+    pcParameter1 = FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameter1StringLength);
+    if (pcParameter1 != NULL)
+    {
+        if (xParameter1StringLength != 1 || *pcParameter1 != '0' || nvLog_erase() != NVINTF_SUCCESS)
+        { cli_writeError(pcWriteBuffer); }
+        else
+        { cli_writeOK(pcWriteBuffer); }
+        return pdFALSE;
+    }
+
+    // The result comes last: nvLog_read() fails before the first record or
+    // not at all, so nothing is flushed for a command that then fails
+    cli_outInit(&out, pcWriteBuffer, xWriteBufferLen);
+    if (nvLog_read(cli_logDumpRecord, &dump) != NVINTF_SUCCESS)
+    { cli_outResult(&out, CLI_RESULT_ERROR); return pdFALSE; }
+
+    cli_outAppendf(&out, "+LOGDONE:%u\r\n", (unsigned int)dump.count);
+    cli_outResult(&out, CLI_RESULT_OK);
+    return pdFALSE;
+}
+static BaseType_t prvAT_BINMODEfxn( char *pcWriteBuffer,
+                                    size_t xWriteBufferLen,
+                                    const char *pcCommandString )
+{
+    // The console already reads frames, the OK is still sent as text
+    if (!cli_uartBinModeQueued())
+    {
+        cli_writeError(pcWriteBuffer);
+        return pdFALSE;
+    }
+    cli_writeOK(pcWriteBuffer);
+    return pdFALSE;
+}
 /*
 static BaseType_t prvAT_BLESTOPfxn( char *pcWriteBuffer,
                                           size_t xWriteBufferLen,
@@ -10,6 +10,8 @@
 #include <icall.h>
 /* POSIX Header files */
 #include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <semaphore.h>
 /* Driver configuration */
@@ -20,11 +22,57 @@
 
 /* Stack size in bytes */
 #define THREADSTACKSIZE 1024
+#define EXEC_THREADSTACKSIZE 1024
 
 #define MAX_INPUT_LENGTH    256
 #define MAX_OUTPUT_LENGTH   512
 
-static uint8_t rxBuffer[MAX_INPUT_LENGTH];
+/* RX is read in chunks of up to CLI_RX_CHUNK_SIZE bytes (partial return on
+ * RX timeout) and queued in a ring buffer for the console thread.
+ * CLI_RX_RING_SIZE must be a power of 2. */
+#define CLI_RX_CHUNK_SIZE   32
+#define CLI_RX_RING_SIZE    512
+#define CLI_ECHO_BATCH_SIZE 64
+
+static uint8_t rxBuffer[CLI_RX_CHUNK_SIZE];
+static uint8_t rxRing[CLI_RX_RING_SIZE];
+static volatile uint16_t rxRingHead = 0;   // written by the RX callback
+static volatile uint16_t rxRingTail = 0;   // written by the console thread
+static volatile uint32_t rxRingDropped = 0;
+
+/* Command lines are run by the executor thread, so the console keeps reading
+ * while a command waits on the BLE stack. A line starting with "#<id> " is
+ * tagged: its final OK/ERROR is replaced by "+DONE:<id>,<result>", so a host
+ * can pipeline up to CLI_CMD_QUEUE_DEPTH commands and match the results. */
+#define CLI_CMD_QUEUE_DEPTH 4
+#define CLI_CMD_NO_TAG      (-1)
+
+typedef struct
+{
+    int32_t tag;
+    uint8_t binary;     // from a binary frame, answered with a response frame
+    uint8_t opcode;
+    uint8_t seq;
+    uint8_t binSwitch;  // framing of the output after the answer, or CLI_BIN_SWITCH_NONE
+    char    line[MAX_INPUT_LENGTH];
+} cli_cmdEntry_t;
+
+static cli_cmdEntry_t cmdQueue[CLI_CMD_QUEUE_DEPTH];
+
+/* AT+BINMODE and the EXIT opcode switch the framing. The console thread
+ * switches its input right after the line or frame, so the bytes behind it
+ * in the same burst are parsed with the new framing. The executor switches
+ * the output once the answer is written, so the answer keeps the old one. */
+#define CLI_BIN_SWITCH_NONE 0xFF
+
+static uint8 rxBinMode = FALSE;             // console thread only
+static cli_cmdEntry_t *pCmdRunning = NULL;  // executor thread only
+static char pcBinOutput[ MAX_OUTPUT_LENGTH ];
+static size_t binOutputLen = 0;
+static uint8 binOutputOverflow = FALSE;
+static volatile uint8_t cmdQueueHead = 0;  // written by the console thread
+static volatile uint8_t cmdQueueTail = 0;  // written by the executor thread
+static sem_t cmdSem;
 
 static const char * const pcCliMessage = "\r\nAmpak WL71340 AT-Command interface.\r\nType \"HELP\" to view a list of registered commands.\r\n";
 static const char * const pcTransModeMessage = "\r\nBLE streaming start. Your input into UART is output to BLE.\r\n";
@@ -32,48 +80,81 @@ const char breakLine[] = "\r\n";
 const char backspace[] = "\b \b";
 /* === Local Variables ===*/
 static sem_t sem;
-static volatile size_t numBytesRead;
 static UART2_Handle cli_uartHandle = NULL;
 static UART2_Params cli_uartParams;
 static uint8 uart_echo_onoff = CLI_UART_ECHO;
 static uint8 cli_uartGiveTransMode = CLI_SWITCH_TRANS_OFF;
+static pthread_mutex_t cli_uartTxMutex;
+static uint8 cli_uartTxMutexInit = FALSE;
 
 ICall_EntityID cli_uartICallEntityID;
 
 /* === Functions === */
 void cli_uartConsoleStart(void);
 void *cli_uartConsoleThread(void *arg0);
+void *cli_uartCmdExecThread(void *arg0);
 void cli_uartRxCB(UART2_Handle handle, void *buffer, size_t count, void *userArg, int_fast16_t status);
 uint8_t cli_uartProcessMsgCB(uint8_t event, uint8_t *pMessage);
 static int_fast16_t cli_uartTxEcho(UART2_Handle handle, const void* pValue, size_t len , size_t *bytesWritten);
+static int_fast16_t cli_uartWrite(UART2_Handle handle, const void* pValue, size_t len);
 bStatus_t cli_switchToTransMode(void);
 
 /*
  *  ======== callbackFxn ========
+ *  Copy the chunk to the ring buffer and re-arm the read right away, so no
+ *  byte is lost while the console thread is busy with a command.
  */
 void cli_uartRxCB(UART2_Handle handle, void *buffer, size_t count, void *userArg, int_fast16_t status)
 {
+    size_t i;
+    uint16_t head = rxRingHead;
+
+    if (status == UART2_STATUS_ECANCELLED)
+    { return; } // UART closed, e.g. switching to transparent mode
+
     if (status != UART2_STATUS_SUCCESS)
     { /* RX error occured in UART2_read() */ while (1) {} }
 
-    numBytesRead = count;
-    sem_post(&sem);
+    for (i = 0; i < count; i++)
+    {
+        if ((uint16_t)(head - rxRingTail) >= CLI_RX_RING_SIZE)
+        {
+            rxRingDropped += count - i;
+            break;
+        }
+        rxRing[head & (CLI_RX_RING_SIZE - 1)] = ((uint8_t *)buffer)[i];
+        head++;
+    }
+    rxRingHead = head;
+
+    UART2_read(handle, rxBuffer, CLI_RX_CHUNK_SIZE, NULL);
+
+    if (count > 0)
+    { sem_post(&sem); }
 }
 
 bStatus_t cli_uartEnable(void)
 {
     bStatus_t status = SUCCESS;
 
-    /* Create a UART in CALLBACK read mode */
+    /* Create a UART in CALLBACK read mode, returning what has been received
+     * when the line goes idle instead of waiting for a full chunk */
     UART2_Params_init(&cli_uartParams);
-    cli_uartParams.readMode     = UART2_Mode_CALLBACK;
-    cli_uartParams.readCallback = cli_uartRxCB;
-    cli_uartParams.baudRate     = 115200;
+    cli_uartParams.readMode       = UART2_Mode_CALLBACK;
+    cli_uartParams.readCallback   = cli_uartRxCB;
+    cli_uartParams.readReturnMode = UART2_ReadReturnMode_PARTIAL;
+    cli_uartParams.baudRate       = 115200;
+
+    rxRingHead = 0;
+    rxRingTail = 0;
 
     cli_uartHandle = UART2_open(CONFIG_DISPLAY_UART, &cli_uartParams);
     if (cli_uartHandle == NULL)
     { while (1) {} /* UART2_open() failed */ }
 
+    if (UART2_read(cli_uartHandle, rxBuffer, CLI_RX_CHUNK_SIZE, NULL) != UART2_STATUS_SUCCESS)
+    { while (1) {} /* UART2_read() failed */ }
+
     return status;
 }
 
@@ -82,97 +163,365 @@ bStatus_t cli_uartDisable(void)
     bStatus_t status = SUCCESS;
     if(cli_uartHandle != NULL)
     {
+        // Wait for an ongoing cli_uartPrint() before closing
+        pthread_mutex_lock(&cli_uartTxMutex);
         UART2_close(cli_uartHandle);
         cli_uartHandle = NULL;
+        pthread_mutex_unlock(&cli_uartTxMutex);
     }
     return status;
 }
 
+/*
+ * Result of the command being run, recorded by its handler through
+ * cli_uartCmdSetResult(). When the caller reports the result itself (tagged
+ * lines, script lines, binary frames) the handler writes no OK/ERROR text.
+ * Executor thread only.
+ */
+static uint8 cmdResult = CLI_RESULT_NONE;
+static uint8 cmdTakeResult = FALSE;
+
+/* Record the result of the running command, returns the text to write for it */
+const char *cli_uartCmdSetResult(uint8 result)
+{
+    cmdResult = result;
+    if (cmdTakeResult)
+    { return ""; }
+    return (result == CLI_RESULT_ERROR) ? "\r\nERROR\r\n" : "\r\nOK\r\n";
+}
+
+/*
+ * Run a line through the interpreter and write its output with
+ * cli_uartCmdOutput(). With takeResult the handler leaves out the OK/ERROR
+ * text.
+ * Returns CLI_RESULT_OK or CLI_RESULT_ERROR; a handler which records nothing
+ * succeeded.
+ */
+static uint8 cli_uartCmdExecute(char *pcInputString, uint8 takeResult)
+{
+    static char pcOutputString[ MAX_OUTPUT_LENGTH ];
+    BaseType_t xMoreDataToFollow;
+    uint8 result;
+
+    cmdResult = CLI_RESULT_NONE;
+    cmdTakeResult = takeResult;
+
+    do{
+        // Handlers that write nothing leave an empty string
+        pcOutputString[0] = '\0';
+
+        // Send the command string to the command interpreter.
+        xMoreDataToFollow = FreeRTOS_CLIProcessCommand(
+                          pcInputString,    //The command string.
+                          pcOutputString,   //The output buffer.
+                          MAX_OUTPUT_LENGTH //The size of the output buffer.
+                      );
+
+        cli_uartCmdOutput(pcOutputString, strlen( pcOutputString ));
+    } while( xMoreDataToFollow != pdFALSE );
+
+    // Unknown commands and wrong parameter counts never reach a handler
+    result = (cmdResult == CLI_RESULT_ERROR || FreeRTOS_CLIInputRejected()) ?
+             CLI_RESULT_ERROR : CLI_RESULT_OK;
+    cmdTakeResult = FALSE;
+    return result;
+}
+
+static bStatus_t cli_uartCmdProcessLine(char *pcInputString, int32_t tag)
+{
+    bStatus_t status = SUCCESS;
+    char pcDone[ 32 ];
+    uint8 result;
+    size_t len;
+
+    result = cli_uartCmdExecute(pcInputString, (tag != CLI_CMD_NO_TAG));
+
+    if (tag != CLI_CMD_NO_TAG && cli_uartHandle != NULL)
+    {
+        len = sprintf(pcDone, "\r\n+DONE:%d,%s\r\n", (int)tag,
+                      (result == CLI_RESULT_OK) ? "OK" : "ERROR");
+        status = cli_uartWrite(cli_uartHandle, pcDone, len);
+    }
+
+    return status;
+}
+
+/* Run one line of a script (cli_script.c), returns CLI_RESULT_OK or CLI_RESULT_ERROR */
+uint8 cli_uartCmdRunLine(char *pcInputString)
+{
+    return cli_uartCmdExecute(pcInputString, TRUE);
+}
+
+/* Run a command received in a binary frame, answer with a response frame */
+static bStatus_t cli_uartCmdProcessBinary(cli_cmdEntry_t *pEntry)
+{
+    uint8 result;
+
+    if (pEntry->opcode == CLI_BIN_OP_EXIT)
+    { return cli_binWriteResponse(pEntry->opcode, pEntry->seq, CLI_BIN_STATUS_OK, NULL, 0); }
+
+    binOutputLen = 0;
+    binOutputOverflow = FALSE;
+    result = cli_uartCmdExecute(pEntry->line, TRUE);
+
+    // A cut answer would look complete to the host
+    if (binOutputOverflow)
+    { return cli_binWriteResponse(pEntry->opcode, pEntry->seq, CLI_BIN_STATUS_TOO_LONG, NULL, 0); }
+
+    return cli_binWriteResponse(pEntry->opcode, pEntry->seq,
+                                (result == CLI_RESULT_OK) ? CLI_BIN_STATUS_OK : CLI_BIN_STATUS_ERROR,
+                                pcBinOutput, binOutputLen);
+}
+
+/* Console thread: switch the framing of the input */
+static void cli_uartBinModeSwitchRx(uint8 onOff)
+{
+    rxBinMode = onOff;
+    if (onOff)
+    { cli_binRxReset(); }
+}
+
+/* A plain "AT+BINMODE" line, without parameters the interpreter would reject */
+static uint8 cli_uartIsBinModeLine(const char *pcLine)
+{
+    static const char binModeCmd[] = "AT+BINMODE";
+    size_t len = sizeof(binModeCmd) - 1;
+
+    if (strncmp(pcLine, binModeCmd, len) != 0)
+    { return FALSE; }
+    while (pcLine[len] == ' ')
+    { len++; }
+    return (pcLine[len] == '\0');
+}
+
+/* Queue a binary frame for the executor thread. Called from the console thread. */
+static bStatus_t cli_uartBinEnqueue(void)
+{
+    cli_cmdEntry_t *pEntry;
+    uint8_t opcode, seq;
+    uint8_t binStatus;
+
+    if ((uint8_t)(cmdQueueHead - cmdQueueTail) >= CLI_CMD_QUEUE_DEPTH)
+    {
+        // Only the header is needed for the answer
+        cli_binFrameToCommand(NULL, 0, &opcode, &seq);
+        return cli_binWriteResponse(opcode, seq, CLI_BIN_STATUS_BUSY, NULL, 0);
+    }
+
+    pEntry = &cmdQueue[cmdQueueHead % CLI_CMD_QUEUE_DEPTH];
+    binStatus = cli_binFrameToCommand(pEntry->line, MAX_INPUT_LENGTH, &opcode, &seq);
+    if (binStatus != CLI_BIN_STATUS_OK)
+    { return cli_binWriteResponse(opcode, seq, binStatus, NULL, 0); }
+
+    pEntry->tag = CLI_CMD_NO_TAG;
+    pEntry->binary = TRUE;
+    pEntry->opcode = opcode;
+    pEntry->seq = seq;
+    pEntry->binSwitch = CLI_BIN_SWITCH_NONE;
+    if (opcode == CLI_BIN_OP_EXIT)
+    {
+        pEntry->binSwitch = FALSE;
+        cli_uartBinModeSwitchRx(FALSE);
+    }
+    cmdQueueHead++;
+    sem_post(&cmdSem);
+
+    return SUCCESS;
+}
+
+/* Queue a line for the executor thread. Called from the console thread. */
+static bStatus_t cli_uartCmdEnqueue(char *pcInputString)
+{
+    int32_t tag = CLI_CMD_NO_TAG;
+    char busyStr[24];
+    char *pcEnd;
+    int len;
+
+    if (pcInputString[0] == '#')
+    {
+        tag = strtol(&pcInputString[1], &pcEnd, 10);
+        if (pcEnd == &pcInputString[1] || *pcEnd != ' ' || tag < 0)
+        {
+            return cli_uartWrite(cli_uartHandle, "\r\nERROR\r\n", 9);
+        }
+        while (*pcEnd == ' ')
+        { pcEnd++; }
+        pcInputString = pcEnd;
+    }
+
+    if ((uint8_t)(cmdQueueHead - cmdQueueTail) >= CLI_CMD_QUEUE_DEPTH)
+    {
+        if (tag == CLI_CMD_NO_TAG)
+        { return cli_uartWrite(cli_uartHandle, "\r\nERROR\r\n", 9); }
+
+        len = sprintf(busyStr, "\r\n+DONE:%d,BUSY\r\n", (int)tag);
+        return cli_uartWrite(cli_uartHandle, busyStr, len);
+    }
+
+    cmdQueue[cmdQueueHead % CLI_CMD_QUEUE_DEPTH].tag = tag;
+    cmdQueue[cmdQueueHead % CLI_CMD_QUEUE_DEPTH].binary = FALSE;
+    cmdQueue[cmdQueueHead % CLI_CMD_QUEUE_DEPTH].binSwitch = CLI_BIN_SWITCH_NONE;
+    strcpy(cmdQueue[cmdQueueHead % CLI_CMD_QUEUE_DEPTH].line, pcInputString);
+    if (cli_uartIsBinModeLine(pcInputString))
+    {
+        cmdQueue[cmdQueueHead % CLI_CMD_QUEUE_DEPTH].binSwitch = TRUE;
+        cli_uartBinModeSwitchRx(TRUE);
+    }
+    cmdQueueHead++;
+    sem_post(&cmdSem);
+
+    return SUCCESS;
+}
+
 static bStatus_t cli_uartCmdReceiver(void)
 {
     bStatus_t status = SUCCESS;
     char cRxedChar;
-    static char pcOutputString[ MAX_OUTPUT_LENGTH ], pcInputString[ MAX_INPUT_LENGTH ];
+    static char pcInputString[ MAX_INPUT_LENGTH ];
     static int cInputIndex = 0;
-    BaseType_t xMoreDataToFollow;
+    char pcEcho[ CLI_ECHO_BATCH_SIZE ];
+    size_t echoLen = 0;
 
-    numBytesRead = 0;
-    /* Pass NULL for bytesRead since it's not used in this example */
-    status = UART2_read(cli_uartHandle, &cRxedChar, 1, NULL);
+    sem_wait(&sem); /* Wait for the RX callback to queue data */
 
-    if (status != UART2_STATUS_SUCCESS)
-    { /* UART2_read() failed */ while (1) {} }
-
-    sem_wait(&sem); /* Do not write until read callback executes */
+    if (cli_uartGiveTransMode)
+    { return status; } // woken up by the executor to switch mode
 
-    if (numBytesRead > 0)
+    // Drain everything received so far, a burst may hold several lines
+    while (rxRingTail != rxRingHead)
     {
-        if(cRxedChar == '\r' || cRxedChar == '\n')
+        cRxedChar = rxRing[rxRingTail & (CLI_RX_RING_SIZE - 1)];
+        rxRingTail++;
+
+        // Binary frames, no echo and no line editing
+        if (rxBinMode)
         {
-            if (strlen( pcInputString ) == 0)
-            { return status; } // in case null string input
+            cInputIndex = 0;
+            if (cli_binRxByte((uint8_t)cRxedChar))
+            { cli_uartBinEnqueue(); }
+            continue;
+        }
 
-            status = cli_uartTxEcho(cli_uartHandle, breakLine, 2, NULL);
-            do{
-                // Send the command string to the command interpreter.
-                xMoreDataToFollow = FreeRTOS_CLIProcessCommand(
-                                  pcInputString,    //The command string.
-                                  pcOutputString,   //The output buffer.
-                                  MAX_OUTPUT_LENGTH //The size of the output buffer.
-                              );
+        // Make room for up to 3 echo bytes (backspace sequence)
+        if (echoLen > CLI_ECHO_BATCH_SIZE - 3)
+        {
+            status = cli_uartTxEcho(cli_uartHandle, pcEcho, echoLen, NULL);
+            echoLen = 0;
+        }
 
-                if (strlen( pcOutputString ) == 0)
-                { continue; } // in case null string output
+        if(cRxedChar == '\r' || cRxedChar == '\n')
+        {
+            if (cInputIndex == 0)
+            { continue; } // in case null string input
 
-                if (cli_uartHandle == NULL)
-                { break; } // in case transparent mode start
+            memcpy(&pcEcho[echoLen], breakLine, 2);
+            status = cli_uartTxEcho(cli_uartHandle, pcEcho, echoLen + 2, NULL);
+            echoLen = 0;
 
-                // Write the output generated by the command interpreter to the console.
-                status = UART2_write(cli_uartHandle, pcOutputString, strlen( pcOutputString ), NULL);
-            } while( xMoreDataToFollow != pdFALSE );
+            pcInputString[ cInputIndex ] = '\0';
+            status |= cli_uartCmdEnqueue(pcInputString);
 
-            //status = UART2_write(cli_uartHandle, breakLine, 2, NULL);
             cInputIndex = 0;
-            memset( pcInputString, 0x00, MAX_INPUT_LENGTH );
-            memset( pcOutputString, 0x00, MAX_OUTPUT_LENGTH );
+
+            // Leave the rest of the burst if the console was handed over
+            if (cli_uartGiveTransMode || cli_uartHandle == NULL)
+            { return status; }
         }
-        else
+        else if(cRxedChar == '\b')
         {
-            if(cRxedChar == '\b')
+            if( cInputIndex > 0 )
             {
-                if( cInputIndex > 0 )
-                {
-                    cInputIndex--;
-                    pcInputString[ cInputIndex ] = '\0';
-                    status = cli_uartTxEcho(cli_uartHandle, backspace, 3, NULL);
-                }
+                cInputIndex--;
+                pcInputString[ cInputIndex ] = '\0';
+                memcpy(&pcEcho[echoLen], backspace, 3);
+                echoLen += 3;
             }
-            else
+        }
+        else
+        {
+            // Keep the last byte for the string terminator
+            if( cInputIndex < MAX_INPUT_LENGTH - 1 )
             {
-                if( cInputIndex < MAX_INPUT_LENGTH )
-                {
-                    pcInputString[ cInputIndex ] = cRxedChar;
-                    cInputIndex++;
-                }
-                status = cli_uartTxEcho(cli_uartHandle, &cRxedChar, 1, NULL);
+                pcInputString[ cInputIndex ] = cRxedChar;
+                cInputIndex++;
             }
+            pcEcho[echoLen++] = cRxedChar;
         }
 
         if (status != UART2_STATUS_SUCCESS)
         { while (1) {} /* UART2_write() failed */ }
     }
+
+    if (echoLen > 0)
+    {
+        status = cli_uartTxEcho(cli_uartHandle, pcEcho, echoLen, NULL);
+        if (status != UART2_STATUS_SUCCESS)
+        { while (1) {} /* UART2_write() failed */ }
+    }
+
     return status;
 }
 
-void *cli_uartConsoleThread(void *arg0)
+void *cli_uartCmdExecThread(void *arg0)
 {
     // IMPORTANT: Task should register to ICall app to access BLE function
     // NOTE: ICall_registerAppCback() invoke in trans_uart task cause fail.
     //       CLI don't use ICall for BLE access so cancel the registry here.
     // FIXED: ICall max num task set to 4
+    // The commands run in this thread, so it is the one registered.
     ICall_Errno icall_staus;
     icall_staus = ICall_registerAppCback(&cli_uartICallEntityID, cli_uartProcessMsgCB);
 
+    while (1)
+    {
+        // Posted once per queued command and once per URC
+        sem_wait(&cmdSem);
+
+        cli_urcFlush();
+
+        // A script requested by AT+SCRIPT or at boot, before the next command
+        cli_scriptRunPending();
+
+        // The console is handed over to transparent mode, drop the lines
+        // that were queued behind AT+BLETRANMODE
+        if (cli_uartGiveTransMode)
+        {
+            cmdQueueTail = cmdQueueHead;
+            continue;
+        }
+
+        if (cmdQueueTail == cmdQueueHead)
+        { continue; }
+
+        // The entry stays owned by this thread until the tail moves on
+        pCmdRunning = &cmdQueue[cmdQueueTail % CLI_CMD_QUEUE_DEPTH];
+        if (pCmdRunning->binary)
+        {
+            cli_uartCmdProcessBinary(pCmdRunning);
+        }
+        else
+        {
+            cli_uartCmdProcessLine(pCmdRunning->line, pCmdRunning->tag);
+        }
+        pCmdRunning = NULL;
+
+        // The answer is out, the following ones and the URCs use the new framing
+        if (cmdQueue[cmdQueueTail % CLI_CMD_QUEUE_DEPTH].binSwitch != CLI_BIN_SWITCH_NONE)
+        { cli_setBinaryMode(cmdQueue[cmdQueueTail % CLI_CMD_QUEUE_DEPTH].binSwitch); }
+        cmdQueueTail++;
+
+        // Wake the console thread up to hand the UART over, the rest of
+        // the burst is not run
+        if (cli_uartGiveTransMode)
+        {
+            cmdQueueTail = cmdQueueHead;
+            sem_post(&sem);
+        }
+    }
+}
+
+void *cli_uartConsoleThread(void *arg0)
+{
     int32_t semStatus;
     uint32_t status = UART2_STATUS_SUCCESS;
 
@@ -181,9 +530,13 @@ void *cli_uartConsoleThread(void *arg0)
     if (semStatus != 0)
     { while (1) {} /* Error creating semaphore */ }
 
+    // Serializes command output with cli_uartPrint() from other tasks
+    if (pthread_mutex_init(&cli_uartTxMutex, NULL) != 0)
+    { while (1) {} /* Error creating mutex */ }
+    cli_uartTxMutexInit = TRUE;
+
     status = cli_uartEnable();
-    /* Pass NULL for bytesWritten since it's not used in this example */
-    status = UART2_write(cli_uartHandle, pcCliMessage, strlen( pcCliMessage ), NULL);
+    status = cli_uartWrite(cli_uartHandle, pcCliMessage, strlen( pcCliMessage ));
 
     /* Loop forever echoing */
     while (1)
@@ -207,7 +560,8 @@ void *cli_uartConsoleThread(void *arg0)
 bStatus_t cli_switchToTransMode(void)
 {
     bStatus_t status = SUCCESS;
-    status = UART2_write(cli_uartHandle, pcTransModeMessage, strlen( pcTransModeMessage ), NULL);
+    // Under the TX mutex, a cli_uartPrint() from another task may be writing
+    status = cli_uartWrite(cli_uartHandle, pcTransModeMessage, strlen( pcTransModeMessage ));
     status |= cli_uartDisable();
     status |= trans_uartEnable();
     trans_modeSetSwitchFlag(TRANS_MODE_ON);
@@ -248,18 +602,99 @@ void cli_uartConsoleStart(void)
     retc = pthread_create(&thread, &attrs, cli_uartConsoleThread, NULL);
     if (retc != 0)
     { while (1) {} /* pthread_create() failed */ }
+
+    /* Command executor, same priority as the console */
+    if (sem_init(&cmdSem, 0, 0) != 0)
+    { while (1) {} /* Error creating semaphore */ }
+
+    retc = pthread_attr_setstacksize(&attrs, EXEC_THREADSTACKSIZE);
+    if (retc != 0)
+    { while (1) {} /* failed to set attributes */ }
+
+    retc = pthread_create(&thread, &attrs, cli_uartCmdExecThread, NULL);
+    if (retc != 0)
+    { while (1) {} /* pthread_create() failed */ }
 }
 
 static int_fast16_t cli_uartTxEcho(UART2_Handle handle, const void* pValue, size_t len , size_t *bytesWritten)
 {
     if(uart_echo_onoff)
     {
-        return UART2_write(handle, pValue, len, NULL);
+        return cli_uartWrite(handle, pValue, len);
     }
     // TODO: all uart2_write should be check again, transparent mode message should move here to CLI
     return 0;
 }
 
+static int_fast16_t cli_uartWrite(UART2_Handle handle, const void* pValue, size_t len)
+{
+    int_fast16_t status;
+
+    // The console may have been closed (transparent mode) since the caller
+    // read the handle, cli_uartDisable() clears it under the same mutex
+    pthread_mutex_lock(&cli_uartTxMutex);
+    if (handle != NULL && handle == cli_uartHandle)
+    {
+        status = UART2_write(handle, pValue, len, NULL);
+    }
+    else
+    {
+        status = UART2_STATUS_EINUSE;
+    }
+    pthread_mutex_unlock(&cli_uartTxMutex);
+
+    return status;
+}
+
+/*
+ * Output of the running command, from the executor thread (cli_outFlush()).
+ * Goes to the console, or into the response frame of a binary command;
+ * if that does not fit in one frame the command is answered with
+ * CLI_BIN_STATUS_TOO_LONG.
+ */
+void cli_uartCmdOutput(const char *pStr, size_t len)
+{
+    if (pCmdRunning != NULL && pCmdRunning->binary)
+    {
+        if (len > MAX_OUTPUT_LENGTH - binOutputLen)
+        {
+            binOutputOverflow = TRUE;
+            len = MAX_OUTPUT_LENGTH - binOutputLen;
+        }
+        memcpy(&pcBinOutput[binOutputLen], pStr, len);
+        binOutputLen += len;
+        return;
+    }
+
+    if (len > 0 && cli_uartHandle != NULL)
+    { cli_uartWrite(cli_uartHandle, pStr, len); }
+}
+
+/*
+ * Write unsolicited output (e.g. scan results) to the console from any task.
+ * Dropped while the console is closed for transparent mode.
+ */
+bStatus_t cli_uartPrint(const char *pStr, size_t len)
+{
+    int_fast16_t status = UART2_STATUS_SUCCESS;
+
+    if (!cli_uartTxMutexInit)
+    { return FAILURE; }
+
+    pthread_mutex_lock(&cli_uartTxMutex);
+    if (cli_uartHandle != NULL)
+    {
+        status = UART2_write(cli_uartHandle, pStr, len, NULL);
+    }
+    else
+    {
+        status = UART2_STATUS_EINUSE;
+    }
+    pthread_mutex_unlock(&cli_uartTxMutex);
+
+    return (status == UART2_STATUS_SUCCESS) ? SUCCESS : FAILURE;
+}
+
 bStatus_t cli_uartSetEchoOnOff(uint8 onOff)
 {
     bStatus_t status = SUCCESS;
@@ -282,12 +717,31 @@ UART2_Handle cli_getUartHandle(void)
     return cli_uartHandle;
 }
 
+/* Bytes dropped because the RX ring was full, since boot */
+uint32_t cli_uartGetRxDropped(void)
+{
+    return rxRingDropped;
+}
+
 int cli_resumeByPostSemaphore(void)
 {
     return sem_post(&sem);
 }
 
+int cli_execResumeByPostSemaphore(void)
+{
+    return sem_post(&cmdSem);
+}
+
 void cli_setTransModeSwitchFlag(uint8 onOff)
 {
     cli_uartGiveTransMode = onOff;
 }
+
+/* From the AT+BINMODE handler: TRUE if the console switched its input after
+ * the running line, see above. Not from a script, whose lines the console
+ * never sees. */
+uint8 cli_uartBinModeQueued(void)
+{
+    return (pCmdRunning != NULL && pCmdRunning->binSwitch == TRUE);
+}
@@ -0,0 +1,225 @@
+/******************************************************************************
+
+@file  cli_urc.c
+
+@brief Unsolicited result codes (URC) for BLE events, e.g. "+CONN:<h>,<addr>".
+
+Group: WCS, BTS
+$Target Device: DEVICES $
+
+******************************************************************************
+$License: BSD3 2022 $
+******************************************************************************
+$Release Name: PACKAGE NAME $
+$Release Date: PACKAGE RELEASE DATE $
+*****************************************************************************/
+
+/*
+ * Producers (BLEAppUtil task) format a line into a small queue and return
+ * without touching the UART. The CLI executor thread writes the queued lines
+ * out between commands. When the queue is full, or the rate limit is hit,
+ * the URC is dropped and counted.
+ * Records of a stream the host asked for (+SCAN of AT+BLESCAN) are longer
+ * and come in bursts. They go through a byte ring instead, length first,
+ * without the mask and the rate limit, and are dropped when it is full.
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "icall_ble_api.h"
+#include <common/FreeRTOSCli/cli_api.h>
+
+/* Queue depth and max length of one URC line, including "\r\n" */
+#define CLI_URC_QUEUE_DEPTH     8
+#define CLI_URC_MAX_LENGTH      40
+
+/* Token bucket: up to CLI_URC_BURST lines at once, CLI_URC_RATE lines/s after */
+#define CLI_URC_BURST           8
+#define CLI_URC_RATE            20
+
+/* Record ring, CLI_URC_RING_SIZE must be a power of 2 */
+#define CLI_URC_RING_SIZE       1024
+#define CLI_URC_RECORD_MAX      255
+
+typedef struct
+{
+    uint8_t len;
+    char    line[CLI_URC_MAX_LENGTH];
+} cli_urcEntry_t;
+
+/* === Local Variables ===*/
+static cli_urcEntry_t urcQueue[CLI_URC_QUEUE_DEPTH];
+static volatile uint8_t urcQueueHead = 0;
+static volatile uint8_t urcQueueTail = 0;
+static uint8 urcMask = CLI_URC_ALL;
+static uint32_t urcTokens = CLI_URC_BURST * configTICK_RATE_HZ;
+static TickType_t urcLastTick = 0;
+static uint32_t urcDropped = 0;
+static uint8_t urcRing[CLI_URC_RING_SIZE];
+static volatile uint16_t urcRingHead = 0;  // written by the producer
+static volatile uint16_t urcRingTail = 0;  // written by the executor thread
+static char urcRecord[CLI_URC_RECORD_MAX];
+
+/* Refill the bucket, take a token. Called in the critical section. */
+static uint8 cli_urcTakeToken(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint32_t elapsed = (uint32_t)(now - urcLastTick);
+
+    urcLastTick = now;
+
+    // One token is worth configTICK_RATE_HZ, so the refill is exact per tick
+    if (elapsed > CLI_URC_BURST * configTICK_RATE_HZ)
+    { elapsed = CLI_URC_BURST * configTICK_RATE_HZ; }
+    urcTokens += elapsed * CLI_URC_RATE;
+    if (urcTokens > CLI_URC_BURST * configTICK_RATE_HZ)
+    { urcTokens = CLI_URC_BURST * configTICK_RATE_HZ; }
+
+    if (urcTokens < configTICK_RATE_HZ)
+    { return FALSE; }
+
+    urcTokens -= configTICK_RATE_HZ;
+    return TRUE;
+}
+
+void cli_urcSetMask(uint8 mask)
+{
+    urcMask = mask & CLI_URC_ALL;
+}
+
+uint8 cli_urcGetMask(void)
+{
+    return urcMask;
+}
+
+uint32_t cli_urcGetDropped(void)
+{
+    return urcDropped;
+}
+
+/*
+ * Queue a URC line, never blocks. The line is formatted as
+ * "\r\n<fmt>\r\n" and truncated to CLI_URC_MAX_LENGTH.
+ */
+bStatus_t cli_urcPost(uint8 type, const char *fmt, ...)
+{
+    char line[CLI_URC_MAX_LENGTH];
+    va_list args;
+    int len;
+
+    if ((urcMask & type) == 0)
+    { return SUCCESS; } // disabled, not an error
+
+    line[0] = '\r';
+    line[1] = '\n';
+    va_start(args, fmt);
+    len = vsnprintf(&line[2], CLI_URC_MAX_LENGTH - 4, fmt, args);
+    va_end(args);
+    if (len < 0)
+    { return FAILURE; }
+    if (len > CLI_URC_MAX_LENGTH - 5)
+    { len = CLI_URC_MAX_LENGTH - 5; }
+    len += 2;
+    line[len++] = '\r';
+    line[len++] = '\n';
+
+    taskENTER_CRITICAL();
+    if ((uint8_t)(urcQueueHead - urcQueueTail) >= CLI_URC_QUEUE_DEPTH ||
+        !cli_urcTakeToken())
+    {
+        urcDropped++;
+        taskEXIT_CRITICAL();
+        return FAILURE;
+    }
+    urcQueue[urcQueueHead % CLI_URC_QUEUE_DEPTH].len = len;
+    memcpy(urcQueue[urcQueueHead % CLI_URC_QUEUE_DEPTH].line, line, len);
+    urcQueueHead++;
+    taskEXIT_CRITICAL();
+
+    // Let the executor thread write it out
+    cli_execResumeByPostSemaphore();
+
+    return SUCCESS;
+}
+
+/*
+ * Free bytes in the record ring. A record takes its length plus one.
+ */
+size_t cli_urcRecordSpace(void)
+{
+    return CLI_URC_RING_SIZE - (uint16_t)(urcRingHead - urcRingTail);
+}
+
+/*
+ * Queue a record of up to CLI_URC_RECORD_MAX bytes, written out as is. Never
+ * blocks. The scan events and the BLEAppUtil task both post records, so the
+ * copy is made in the critical section, it is short.
+ */
+bStatus_t cli_urcPostRecord(const char *pRec, size_t len)
+{
+    uint16_t head;
+    size_t i;
+
+    if (len == 0 || len > CLI_URC_RECORD_MAX)
+    { return INVALIDPARAMETER; }
+
+    taskENTER_CRITICAL();
+    head = urcRingHead;
+    if (CLI_URC_RING_SIZE - (uint16_t)(head - urcRingTail) < len + 1)
+    {
+        urcDropped++;
+        taskEXIT_CRITICAL();
+        return FAILURE;
+    }
+
+    urcRing[head++ & (CLI_URC_RING_SIZE - 1)] = (uint8_t)len;
+    for (i = 0; i < len; i++)
+    { urcRing[head++ & (CLI_URC_RING_SIZE - 1)] = pRec[i]; }
+    urcRingHead = head;
+    taskEXIT_CRITICAL();
+
+    cli_execResumeByPostSemaphore();
+
+    return SUCCESS;
+}
+
+/*
+ * Write the queued URCs to the console. Called from the CLI executor thread
+ * only, between commands, so a URC never splits a command response.
+ */
+void cli_urcFlush(void)
+{
+    cli_urcEntry_t entry;
+    uint16_t tail;
+    uint8_t len, i;
+
+    while (urcQueueTail != urcQueueHead)
+    {
+        entry = urcQueue[urcQueueTail % CLI_URC_QUEUE_DEPTH];
+        urcQueueTail++;
+
+        // In binary mode a URC goes out as a frame, without the "\r\n" around it
+        if (cli_getBinaryMode())
+        { cli_binWriteResponse(CLI_BIN_OP_URC, 0, CLI_BIN_STATUS_OK, &entry.line[2], entry.len - 4); }
+        else
+        { cli_uartPrint(entry.line, entry.len); }
+    }
+
+    while (urcRingTail != urcRingHead)
+    {
+        tail = urcRingTail;
+        len = urcRing[tail++ & (CLI_URC_RING_SIZE - 1)];
+        for (i = 0; i < len; i++)
+        { urcRecord[i] = urcRing[tail++ & (CLI_URC_RING_SIZE - 1)]; }
+        urcRingTail = tail;
+
+        // Records end with "\r\n", a frame does not need it
+        if (cli_getBinaryMode())
+        { cli_binWriteResponse(CLI_BIN_OP_URC, 0, CLI_BIN_STATUS_OK, urcRecord, (len > 2) ? len - 2 : len); }
+        else
+        { cli_uartPrint(urcRecord, len); }
+    }
+}
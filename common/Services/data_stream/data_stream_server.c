@@ -156,7 +156,7 @@ bStatus_t DSS_addService( void )
   bStatus_t status = SUCCESS;
 
   // Allocate Client Characteristic Configuration table
-  dss_dataOut_config = (gattCharCfg_t *)ICall_malloc( sizeof(gattCharCfg_t) * MAX_NUM_BLE_CONNS );
+  dss_dataOut_config = (gattCharCfg_t *)ICall_mallocTag( sizeof(gattCharCfg_t) * MAX_NUM_BLE_CONNS, ICALL_HEAP_TAG_DSS );
   if ( dss_dataOut_config == NULL )
   {
     return ( bleMemAllocError );
@@ -279,7 +279,7 @@ static bStatus_t DSS_writeAttrCB( uint16 connHandle,
     if ( status == SUCCESS )
     {
       // This allocation will be free by bleapp_util
-      cccUpdate = (DSS_cccUpdate_t *)ICall_malloc( sizeof( DSS_cccUpdate_t ) );
+      cccUpdate = (DSS_cccUpdate_t *)ICall_mallocTag( sizeof( DSS_cccUpdate_t ), ICALL_HEAP_TAG_DSS );
       if ( cccUpdate == NULL )
       {
         // Return error status
@@ -311,7 +311,7 @@ static bStatus_t DSS_writeAttrCB( uint16 connHandle,
       }
 
       // This allocation will be free by bleapp_util
-      dataIn = (DSS_dataIn_t *)ICall_malloc( sizeof( DSS_dataIn_t ) + len);
+      dataIn = (DSS_dataIn_t *)ICall_mallocTag( sizeof( DSS_dataIn_t ) + len, ICALL_HEAP_TAG_DSS );
       if ( dataIn == NULL )
       {
         // Return error status
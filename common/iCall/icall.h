@@ -486,6 +486,46 @@ typedef struct
   uint32_t largestFreeSize;
 }ICall_heapStats_t;
 
+/**
+ * @brief Heap allocation tags, identify the subsystem owning a block.
+ *        Only tracked when ICALL_HEAP_TAGGING is defined. This is a debug
+ *        build option, not set in the project configurations: every block
+ *        freed with ICall_free must then come from ICall_malloc.
+ *        See @ref ICall_mallocTag and @ref ICall_getHeapTagStats
+ */
+typedef enum
+{
+  ICALL_HEAP_TAG_DEFAULT,     //!< Untagged allocations (BLE stack, ICall)
+  ICALL_HEAP_TAG_BLEAPPUTIL,  //!< BLEAppUtil event messages
+  ICALL_HEAP_TAG_DSS,         //!< Data stream service
+  ICALL_HEAP_TAG_WORKER,      //!< Worker thread call arguments
+  ICALL_HEAP_TAG_NUM
+} ICall_heapTag_e;
+
+/** @brief Per tag heap usage, see @ref ICall_getHeapTagStats */
+typedef struct
+{
+  uint32_t liveBytes;   //!< Bytes currently allocated
+  uint32_t peakBytes;   //!< Max bytes allocated at once
+  uint32_t liveBlocks;  //!< Blocks currently allocated
+  uint32_t allocFails;  //!< Number of failed allocations
+}ICall_heapTagStats_t;
+
+#ifdef CC23X0
+/** @brief Worker thread statistics, see @ref ICall_workerThreadGetStats */
+typedef struct
+{
+  uint32_t jobsDone;        //!< Number of function calls executed
+  uint32_t jobsRejected;    //!< Number of requests that could not be queued
+  uint32_t jobsInline;      //!< Number of requests with the argument held inline
+  uint32_t totalJobTicks;   //!< Sum of the execution time of all jobs (ticks)
+  uint32_t maxJobTicks;     //!< Longest execution time of a single job (ticks)
+  uint16_t queueDepth;      //!< Configured queue depth
+  uint16_t queueHighWater;  //!< Max number of pending requests ever seen
+  uint16_t maxBatch;        //!< Max number of jobs executed in one wake-up
+}ICall_workerThreadStats_t;
+#endif
+
 /**
  * @brief  Prototype of a function used to compare a received message for a match
  * @param src   originator of the message as a service enumeration
@@ -1075,6 +1115,18 @@ extern ICall_EntityID ICall_searchServiceEntity(ICall_ServiceEnum service);
  * @return     On success return zero; on error,-1 is returned
  */
 extern int ICall_workerThreadSendMsg(void *func, void *arg, uint16 size);
+
+/**
+ * @brief   Get the worker thread queue and execution statistics
+ *
+ * @param pStats pointer to the structure to fill
+ */
+extern void ICall_workerThreadGetStats(ICall_workerThreadStats_t *pStats);
+
+/**
+ * @brief   Reset the worker thread statistics counters
+ */
+extern void ICall_workerThreadResetStats(void);
 #endif
 
 #ifdef ICALL_LITE
@@ -1304,6 +1356,29 @@ void *ICall_mallocLimited(uint_least16_t size);
  */
 void ICall_getHeapStats(ICall_heapStats_t *stats);
 
+/**
+ * Allocates a memory block on behalf of a subsystem.
+ * When ICALL_HEAP_TAGGING is defined the tag is stored in the block header
+ * and accounted in the per tag statistics, otherwise this is the same as
+ * @ref ICall_malloc.
+ * @param size   size of the block in bytes.
+ * @param tag    owner of the block, one of @ref ICall_heapTag_e
+ * @return address of the allocated memory block or NULL
+ *         if allocation fails.
+ */
+void *ICall_mallocTag(uint_least16_t size, uint8_t tag);
+
+/**
+ * @brief Get the heap usage of a subsystem.
+ * @param tag     one of @ref ICall_heapTag_e
+ * @param pStats  pointer to the structure to fill
+ * @return @ref ICALL_ERRNO_SUCCESS when successful.<br>
+ *         @ref ICALL_ERRNO_INVALID_PARAMETER when the tag is out of range.<br>
+ *         @ref ICALL_ERRNO_INVALID_FUNCTION when ICALL_HEAP_TAGGING is
+ *         not defined.
+ */
+ICall_Errno ICall_getHeapTagStats(uint8_t tag, ICall_heapTagStats_t *pStats);
+
 /**
  * @brief Sends a message to an entity.
  * @param src     entity id of the sender
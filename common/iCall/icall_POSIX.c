@@ -445,21 +445,41 @@ static ICall_CSState ICall_heapCSState;
 /* worker thread stack size was selected after the ECC SW operation
    usage was determined (~800 bytes) */
 #define ICALL_WORKER_THREAD_STACKSIZE   1024
+/* max number of pending requests. Bursts of pairing requests each
+   queue an ECC operation, 8 was found to be too shallow */
+#ifndef ICALL_WORKER_THREAD_QUEUE_SIZE
+#define ICALL_WORKER_THREAD_QUEUE_SIZE  16
+#endif
+/* arguments up to this size are copied into the queue message itself
+   instead of being allocated from the heap. 0 disables inline storage */
+#ifndef ICALL_WORKER_THREAD_INLINE_ARG_SIZE
+#define ICALL_WORKER_THREAD_INLINE_ARG_SIZE  16
+#endif
+/* max number of jobs executed per wake-up of the worker thread */
+#ifndef ICALL_WORKER_THREAD_BATCH_SIZE
+#define ICALL_WORKER_THREAD_BATCH_SIZE  4
+#endif
 
 /** @internal data structure for the Worker Thread entity */
 typedef struct
 {
   pthread_t threadId;
   mqd_t     queueHandle;
+  uint16_t  pending;
+  ICall_workerThreadStats_t stats;
 } ICall_workerThreadEntity_t;
 
-ICall_workerThreadEntity_t workerThreadEntity;
+ICall_workerThreadEntity_t workerThreadEntity = { .queueHandle = (mqd_t)-1 };
 
 /** @internal data structure for the Worker Thread queue message */
 typedef struct
 {
   void                  *func;
-  void                  *arg;
+  void                  *arg;       /* heap allocated argument, or NULL */
+  uint16_t              inlineSize; /* size of the argument in inlineArg, or 0 */
+#if ICALL_WORKER_THREAD_INLINE_ARG_SIZE > 0
+  uint32_t              inlineArg[(ICALL_WORKER_THREAD_INLINE_ARG_SIZE + 3) / 4];
+#endif
 } ICall_WorkerThreadMsg_t;
 
 #endif
@@ -677,23 +697,68 @@ void ICall_init(void)
 }
 
 #ifdef CC23X0
+/**
+ * @internal Executes a single worker thread request and updates the stats.
+ * @param msg  the request received from the worker thread queue
+ */
+static void ICall_workerThreadExecute(ICall_WorkerThreadMsg_t *msg)
+{
+  typedef void (*ICall_workerThreadFuncArg)(void *arg);
+  typedef void (*ICall_workerThreadFunc)(void);
+  uint_fast32_t start = ICall_getTicks();
+  uint32_t elapsed;
+
+#if ICALL_WORKER_THREAD_INLINE_ARG_SIZE > 0
+  if (msg->inlineSize > 0)
+  {
+    // execute the function call with the argument stored in the msg
+    ((ICall_workerThreadFuncArg)(msg->func))((void *) msg->inlineArg);
+  }
+  else
+#endif
+  if (msg->arg != NULL)
+  {
+    // execute the function call
+    ((ICall_workerThreadFuncArg)(msg->func))((void *) msg->arg);
+    // free the function call argument
+    ICall_free( msg->arg );
+  }
+  else
+  {
+    // execute the function call without argument
+    ((ICall_workerThreadFunc)(msg->func))();
+  }
+
+  elapsed = (uint32_t)(ICall_getTicks() - start);
+  workerThreadEntity.stats.jobsDone++;
+  workerThreadEntity.stats.totalJobTicks += elapsed;
+  if (elapsed > workerThreadEntity.stats.maxJobTicks)
+  {
+    workerThreadEntity.stats.maxJobTicks = elapsed;
+  }
+}
+
 /**
  * @brief   The worker thread entry function.
  *          This task waits forever on queue message
  *          and executes a requested function call.
+ *          Once woken up, it executes up to ICALL_WORKER_THREAD_BATCH_SIZE
+ *          pending requests before waiting again.
  */
 void *ICall_workerThreadEntry(void *arg)
 {
   ICall_WorkerThreadMsg_t msg;
   struct mq_attr attr;
-  typedef void (*ICall_workerThreadFuncArg)(void *arg);
-  typedef void (*ICall_workerThreadFunc)(void);
+  ICall_CSState key;
+  uint16_t batch;
 
   attr.mq_flags = 0; //Blocking
   attr.mq_curmsgs = 0;
-  attr.mq_maxmsg = 8;
+  attr.mq_maxmsg = ICALL_WORKER_THREAD_QUEUE_SIZE;
   attr.mq_msgsize = sizeof(ICall_WorkerThreadMsg_t);
 
+  workerThreadEntity.stats.queueDepth = ICALL_WORKER_THREAD_QUEUE_SIZE;
+
   /* Open the message queue */
   workerThreadEntity.queueHandle = mq_open("ble_icall", O_CREAT , 0, &attr);
 
@@ -705,21 +770,34 @@ void *ICall_workerThreadEntry(void *arg)
   for(;;)  // Forever Loop
   {
     // wait until receive queue message
-    if (mq_receive(workerThreadEntity.queueHandle, (char*)&msg, sizeof(msg), NULL) > 0)
+    if (mq_receive(workerThreadEntity.queueHandle, (char*)&msg, sizeof(msg), NULL) <= 0)
     {
-      if (msg.arg != NULL)
-      {
-        // execute the function call
-        ((ICall_workerThreadFuncArg)(msg.func))((void *) msg.arg);
-        // free the function call argument
-        ICall_free( msg.arg );
-      }
-      else
+      continue;
+    }
+
+    batch = 0;
+    for(;;)
+    {
+      key = ICall_enterCSImpl();
+      workerThreadEntity.pending--;
+      ICall_leaveCSImpl(key);
+
+      ICall_workerThreadExecute(&msg);
+      batch++;
+
+      // keep going while there is pending work, the queue will not block
+      if ((batch >= ICALL_WORKER_THREAD_BATCH_SIZE) ||
+          (workerThreadEntity.pending == 0) ||
+          (mq_receive(workerThreadEntity.queueHandle, (char*)&msg, sizeof(msg), NULL) <= 0))
       {
-        // execute the function call without argument
-        ((ICall_workerThreadFunc)(msg.func))();
+        break;
       }
     }
+
+    if (batch > workerThreadEntity.stats.maxBatch)
+    {
+      workerThreadEntity.stats.maxBatch = batch;
+    }
   }
 
   return NULL;
@@ -756,31 +834,79 @@ int ICall_createWorkerThread(void)
 int ICall_workerThreadSendMsg(void *func, void *arg, uint16 size)
 {
   ICall_WorkerThreadMsg_t msg;
+  ICall_CSState key;
   int status = -1;
 
   // set the function call
   msg.func = func;
   msg.arg = NULL;
+  msg.inlineSize = 0;
+
+  // reserve a queue slot before sending, the worker thread may preempt
+  // this thread as soon as the msg is in the queue. The check and the
+  // count are one step, so concurrent senders never overfill the queue
+  // and mq_send() below never blocks
+  key = ICall_enterCSImpl();
+  if ((workerThreadEntity.queueHandle == (mqd_t)-1) ||
+      (workerThreadEntity.pending >= ICALL_WORKER_THREAD_QUEUE_SIZE))
+  {
+    workerThreadEntity.stats.jobsRejected++;
+    ICall_leaveCSImpl(key);
+    return status;
+  }
+  workerThreadEntity.pending++;
+  if (workerThreadEntity.pending > workerThreadEntity.stats.queueHighWater)
+  {
+    workerThreadEntity.stats.queueHighWater = workerThreadEntity.pending;
+  }
+  ICall_leaveCSImpl(key);
+
   // check if there is an argument to the function call
   if ((arg != NULL) && (size > 0))
   {
-    // allocate and set the function call argument
-    msg.arg = (void *)ICall_malloc( size );
-    if (msg.arg != NULL)
+#if ICALL_WORKER_THREAD_INLINE_ARG_SIZE > 0
+    if (size <= ICALL_WORKER_THREAD_INLINE_ARG_SIZE)
     {
-      memcpy( msg.arg, arg, size);
+      // small argument, keep it in the msg itself
+      memcpy( msg.inlineArg, arg, size);
+      msg.inlineSize = size;
     }
     else
+#endif
     {
-      return status;
+      // allocate and set the function call argument
+      msg.arg = (void *)ICall_mallocTag( size, ICALL_HEAP_TAG_WORKER );
+      if (msg.arg != NULL)
+      {
+        memcpy( msg.arg, arg, size);
+      }
+      else
+      {
+        // give the slot back
+        key = ICall_enterCSImpl();
+        workerThreadEntity.pending--;
+        workerThreadEntity.stats.jobsRejected++;
+        ICall_leaveCSImpl(key);
+        return status;
+      }
     }
   }
-  // check if the worker thread queue is valid
-  if (workerThreadEntity.queueHandle != (mqd_t)-1)
+
+  // send the msg to the worker thread queue
+  status = mq_send(workerThreadEntity.queueHandle,(char*)&msg,sizeof(msg),1);
+
+  key = ICall_enterCSImpl();
+  if (status == -1)
   {
-    // send the msg to the worker thread queue
-    status = mq_send(workerThreadEntity.queueHandle,(char*)&msg,sizeof(msg),1);
+    workerThreadEntity.pending--;
+    workerThreadEntity.stats.jobsRejected++;
   }
+  else if (msg.inlineSize > 0)
+  {
+    workerThreadEntity.stats.jobsInline++;
+  }
+  ICall_leaveCSImpl(key);
+
   if ((status == -1) && (msg.arg != NULL))
   {
     // free the function argument in case the msg was not sent
@@ -788,6 +914,28 @@ int ICall_workerThreadSendMsg(void *func, void *arg, uint16 size)
   }
   return status;
 }
+
+/* See header file for comments. */
+void ICall_workerThreadGetStats(ICall_workerThreadStats_t *pStats)
+{
+  ICall_CSState key;
+
+  key = ICall_enterCSImpl();
+  *pStats = workerThreadEntity.stats;
+  ICall_leaveCSImpl(key);
+}
+
+/* See header file for comments. */
+void ICall_workerThreadResetStats(void)
+{
+  ICall_CSState key;
+
+  key = ICall_enterCSImpl();
+  memset(&workerThreadEntity.stats, 0, sizeof(workerThreadEntity.stats));
+  workerThreadEntity.stats.queueDepth = ICALL_WORKER_THREAD_QUEUE_SIZE;
+  workerThreadEntity.stats.queueHighWater = workerThreadEntity.pending;
+  ICall_leaveCSImpl(key);
+}
 #endif
 
 /* See header file for comments */
@@ -1210,13 +1358,13 @@ static ICall_Errno ICall_primSend(ICall_SendArgs *args)
   {
     if (ICall_entities[args->dest.entityId].appCallback != NULL)
     {
-      uint8_t safeToDealloc = ICall_entities[args->dest.entityId].appCallback(event, (uint8_t *)args->msg);
+      uint8_t safeToDealloc = ICall_entities[args->dest.entityId].appCallback(0 /*event*/, (uint8_t *)args->msg);
       if (args->msg && safeToDealloc)
       {
         ICall_freeMsg(args->msg);
       }
     }
-    return ICALL_ERRNO_SUCCESS
+    return ICALL_ERRNO_SUCCESS;
   }
 #endif // ICALL_NO_APP_EVENTS
   ICall_msgEnqueue(&ICall_entities[args->dest.entityId].task->queue, args->msg);
@@ -2947,27 +3095,86 @@ ICall_enrollService(ICall_ServiceEnum service,
 }
 #ifdef FREERTOS
 
+#ifdef ICALL_HEAP_TAGGING
 /**
- * Allocates a memory block.
+ * @internal Header stored in front of each block when tagging is enabled.
+ * Kept at 8 bytes so that the returned pointer keeps the heap alignment.
+ * Note that every block freed with ICall_free must then come from ICall_malloc.
+ */
+typedef struct
+{
+  uint8_t  tag;
+  uint8_t  reserved[3];
+  uint32_t size;
+} ICall_heapTagHdr_t;
+
+/** @internal per tag heap usage, protected by the ICall critical section */
+static ICall_heapTagStats_t ICall_heapTagStats[ICALL_HEAP_TAG_NUM];
+#endif // ICALL_HEAP_TAGGING
+
+/**
+ * @internal Allocates a memory block and accounts it to a tag.
  * @param size   size of the block in bytes.
+ * @param tag    owner of the block
  * @return address of the allocated memory block or NULL
  *         if allocation fails.
  */
-
-void *ICall_heapMalloc(uint32_t size)
+static void *ICall_heapMallocTag(uint32_t size, uint8_t tag)
 {
   // Enter CS to avoid race with allocation from interrupt context
   ICall_CSState key;
   key = ICall_enterCSImpl();
 
   void* ret = NULL;
+#ifdef ICALL_HEAP_TAGGING
+  ICall_heapTagHdr_t *hdr;
+
+  if (tag >= ICALL_HEAP_TAG_NUM)
+  {
+    tag = ICALL_HEAP_TAG_DEFAULT;
+  }
+
+  hdr = (ICall_heapTagHdr_t *) malloc(sizeof(ICall_heapTagHdr_t) + size);
+  if (hdr != NULL)
+  {
+    ICall_heapTagStats_t *stats = &ICall_heapTagStats[tag];
+
+    hdr->tag = tag;
+    hdr->size = size;
+    stats->liveBytes += size;
+    stats->liveBlocks++;
+    if (stats->liveBytes > stats->peakBytes)
+    {
+      stats->peakBytes = stats->liveBytes;
+    }
+    ret = (void *) (hdr + 1);
+  }
+  else
+  {
+    ICall_heapTagStats[tag].allocFails++;
+  }
+#else
+  (void) tag;
   ret = malloc(size);
+#endif // ICALL_HEAP_TAGGING
 
   ICall_leaveCSImpl(key);
 
   return ret;
 }
 
+/**
+ * Allocates a memory block.
+ * @param size   size of the block in bytes.
+ * @return address of the allocated memory block or NULL
+ *         if allocation fails.
+ */
+
+void *ICall_heapMalloc(uint32_t size)
+{
+  return ICall_heapMallocTag(size, ICALL_HEAP_TAG_DEFAULT);
+}
+
 /**
  * Frees an allocated memory block.
  * @param msg  pointer to a memory block to free.
@@ -2980,7 +3187,21 @@ void ICall_heapFree(void *msg)
 
   if(msg != NULL)
   {
+#ifdef ICALL_HEAP_TAGGING
+    ICall_heapTagHdr_t *hdr = (ICall_heapTagHdr_t *) msg - 1;
+
+    // A tag out of range is not a header of ours, keep the statistics sane
+    if (hdr->tag < ICALL_HEAP_TAG_NUM)
+    {
+      ICall_heapTagStats_t *stats = &ICall_heapTagStats[hdr->tag];
+
+      stats->liveBytes -= hdr->size;
+      stats->liveBlocks--;
+    }
+    free(hdr);
+#else
     free(msg);
+#endif // ICALL_HEAP_TAGGING
   }
 
   ICall_leaveCSImpl(key);
@@ -2998,6 +3219,53 @@ void ICall_heapGetStats(ICall_heapStats_t *pStats)
 
   pStats->totalFreeSize = pHeapStats.xAvailableHeapSpaceInBytes;
   pStats->totalSize = configTOTAL_HEAP_SIZE;
+  pStats->largestFreeSize = pHeapStats.xSizeOfLargestFreeBlockInBytes;
+}
+
+/* See header file for comments. */
+void *ICall_mallocTag(uint_least16_t size, uint8_t tag)
+{
+  return (ICall_heapMallocTag(size, tag));
+}
+
+/* See header file for comments. */
+ICall_Errno ICall_getHeapTagStats(uint8_t tag, ICall_heapTagStats_t *pStats)
+{
+#ifdef ICALL_HEAP_TAGGING
+  ICall_CSState key;
+
+  if (tag >= ICALL_HEAP_TAG_NUM)
+  {
+    return (ICALL_ERRNO_INVALID_PARAMETER);
+  }
+
+  key = ICall_enterCSImpl();
+  *pStats = ICall_heapTagStats[tag];
+  ICall_leaveCSImpl(key);
+
+  return (ICALL_ERRNO_SUCCESS);
+#else
+  (void) tag;
+  (void) pStats;
+  return (ICALL_ERRNO_INVALID_FUNCTION);
+#endif // ICALL_HEAP_TAGGING
+}
+
+#else /* FREERTOS */
+
+/* See header file for comments. Tagging is only supported with FREERTOS. */
+void *ICall_mallocTag(uint_least16_t size, uint8_t tag)
+{
+  (void) tag;
+  return (ICall_heapMalloc(size));
+}
+
+/* See header file for comments. */
+ICall_Errno ICall_getHeapTagStats(uint8_t tag, ICall_heapTagStats_t *pStats)
+{
+  (void) tag;
+  (void) pStats;
+  return (ICALL_ERRNO_INVALID_FUNCTION);
 }
 
 #endif // FREERTOS
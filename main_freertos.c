@@ -29,6 +29,7 @@
 #include <ti/drivers/power/PowerCC23X0.h>
 #include <ti/display/Display.h>
 #include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/HwiP.h>
 #include <ti/common/cc26xx/uartlog/UartLog.h>
 #include <ti/devices/DeviceFamily.h>
 
@@ -36,6 +37,7 @@
 #include <icall.h>
 #include "hal_assert.h"
 #include "bcomdef.h"
+#include <common/Drivers/NV/nv_log.h>
 
 #ifndef USE_DEFAULT_USER_CFG
 #include "ble_user_config.h"
@@ -173,9 +175,19 @@ void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
  */
 void AssertHandler(uint8 assertCause, uint8 assertSubcause)
 {
+    uint8 logData[2] = { assertCause, assertSubcause };
+
     Log_error2(">>>STACK ASSERT Cause 0x%02x subCause 0x%02x",
                assertCause, assertSubcause);
 
+    // Kept for AT+LOGDUMP after a reset, ignored before the log is up.
+    // Skipped in interrupts (the log takes a mutex and may erase a page),
+    // and never waits: the asserting thread may be the one holding it.
+    if(!HwiP_inISR())
+    {
+        nvLog_tryAppend(NV_LOG_ASSERT, logData, sizeof(logData));
+    }
+
     // check the assert cause
     switch(assertCause)
     {